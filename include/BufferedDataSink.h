@@ -0,0 +1,41 @@
+#ifndef BUFFEREDDATASINK_H
+#define BUFFEREDDATASINK_H
+
+#include "DataSink.h"
+#include <cstddef>
+
+// Data sink that collects output in a buffer of fixed capacity in front of
+// a file descriptor. Put and small writes only copy into the buffer, a write
+// that does not fit goes out together with the buffered bytes in a single
+// writev. Errors from the descriptor are reported by the call that flushes.
+class CBufferedDataSink : public CDataSink{
+    private:
+        int DDescriptor;
+        bool DOwnsDescriptor;
+        bool DLineBuffered;
+        bool DGood;
+        std::size_t DCapacity;
+        std::vector<char> DBuffer;
+
+        bool WriteThrough(const char *data, std::size_t length) noexcept;
+
+    protected:
+        // linebuffered also flushes at every newline, which suits terminals
+        CBufferedDataSink(int descriptor, bool ownsdescriptor, std::size_t capacity, bool linebuffered);
+
+    public:
+        static const std::size_t DefaultCapacity = 65536;
+
+        ~CBufferedDataSink();
+
+        CBufferedDataSink(const CBufferedDataSink &) = delete;
+        CBufferedDataSink &operator=(const CBufferedDataSink &) = delete;
+
+        std::size_t Capacity() const noexcept;
+
+        bool Put(const char &ch) noexcept override;
+        bool Write(const std::vector<char> &buf) noexcept override;
+        bool Flush() noexcept override;
+};
+
+#endif
@@ -3,6 +3,9 @@
 
 #include <memory>
 #include <string>
+#include <string_view>
+#include <charconv>
+#include <type_traits>
 #include "DataSource.h"
 
 class CDSVReader{
@@ -11,11 +14,35 @@ class CDSVReader{
         std::unique_ptr<SImplementation> DImplementation;
 
     public:
-        CDSVReader(std::shared_ptr< CDataSource > src, char delimiter);
+        // a threadcount other than 1 parses a memory mapped source in the
+        // background on that many threads, 0 meaning one per core. Rows still
+        // come back in file order, each as soon as its part of the file is
+        // parsed. Other sources are always read as they are consumed.
+        CDSVReader(std::shared_ptr< CDataSource > src, char delimiter, std::size_t threadcount = 1);
         ~CDSVReader();
 
         bool End() const;
         bool ReadRow(std::vector<std::string> &row);
+        // reads a row without copying it, the views point into the reader and
+        // stay valid until the next ReadRow
+        bool ReadRow(std::vector<std::string_view> &row);
+
+        // fields of the row read last, valid until the next ReadRow
+        std::size_t FieldCount() const;
+        std::string_view Field(std::size_t index) const;
+
+        // converts the whole field to a number, false if index is out of
+        // range or the field is not a number of that type
+        template <typename T>
+        bool Field(std::size_t index, T &value) const{
+            static_assert(std::is_integral<T>::value || std::is_floating_point<T>::value, "fields convert to numbers");
+            auto Text = Field(index);
+            if(index >= FieldCount() || Text.empty()){
+                return false;
+            }
+            auto Result = std::from_chars(Text.data(), Text.data() + Text.size(), value);
+            return Result.ec == std::errc() && Result.ptr == Text.data() + Text.size();
+        };
 };
 
 #endif
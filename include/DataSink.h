@@ -8,6 +8,8 @@ class CDataSink{
         virtual ~CDataSink(){};
         virtual bool Put(const char &ch) noexcept = 0;
         virtual bool Write(const std::vector<char> &buf) noexcept = 0;
+        // pushes anything the sink is holding on to out to its destination
+        virtual bool Flush() noexcept{ return true; };
 };
 
 #endif
@@ -4,11 +4,19 @@
 #include "PathRouter.h"
 #include <memory>
 
+class CSnapshotReader;
+class CSnapshotWriter;
+
 class CDijkstraPathRouter : public CPathRouter{
     private:
         struct SImplementation;
         std::unique_ptr<SImplementation> DImplementation;
     public:
+        // Dijkstra searches forward from src, Bidirectional also searches
+        // backward from dest, ContractionHierarchy uses the hierarchy built
+        // by Precompute
+        enum class ESearchMode {Dijkstra, Bidirectional, ContractionHierarchy};
+
         CDijkstraPathRouter();
         ~CDijkstraPathRouter();
 
@@ -18,6 +26,13 @@ class CDijkstraPathRouter : public CPathRouter{
         bool AddEdge(TVertexID src, TVertexID dest, double weight, bool bidir = false) noexcept;
         bool Precompute(std::chrono::steady_clock::time_point deadline) noexcept;
         double FindShortestPath(TVertexID src, TVertexID dest, std::vector<TVertexID> &path) noexcept;
+
+        void SetSearchMode(ESearchMode mode) noexcept;
+        ESearchMode SearchMode() const noexcept;
+        std::size_t SettledVertexCount() const noexcept;
+
+        bool WriteSnapshot(CSnapshotWriter &writer) noexcept;
+        bool ReadSnapshot(CSnapshotReader &reader) noexcept;
 };
 
 #endif
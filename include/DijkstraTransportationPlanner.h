@@ -2,21 +2,65 @@
 #define DIJKSTRATRANSPORTATIONPLANNER_H
 
 #include "TransportationPlanner.h"
+#include "DataSink.h"
 
 class CDijkstraTransportationPlanner : public CTransportationPlanner{
     private:
         struct SImplementation;
         std::unique_ptr<SImplementation> DImplementation;
+
+        CDijkstraTransportationPlanner();
     public:
+        // Dijkstra uses the precomputed router for shortest paths, AStar
+        // steers fastest paths toward the destination, and shortest paths
+        // too if Precompute ran out of time. Raptor finds fastest paths round
+        // by round over the bus routes and shortest paths like Dijkstra. The
+        // strategy may change while queries run, each query uses the one set
+        // when it started.
+        enum class ESearchStrategy {Dijkstra, AStar, Raptor};
+        // source and destination node of one query in a batch
+        using TQuery = std::pair<TNodeID, TNodeID>;
+        // one journey FindFastestPathOptions returns, times are in hours
+        struct SPathOption{
+            double DTime; // travel time
+            std::size_t DRides; // buses boarded, one more than the transfers
+            double DWalkTime; // time spent walking
+            std::vector< TTripStep > DPath;
+        };
+
         CDijkstraTransportationPlanner(std::shared_ptr<SConfiguration> config);
         ~CDijkstraTransportationPlanner();
 
+        bool WriteSnapshot(std::shared_ptr<CDataSink> sink);
+        static std::shared_ptr<CDijkstraTransportationPlanner> LoadSnapshot(const std::string &filename);
+
+        // choosing Raptor the first time builds its tables and may throw
+        void SetSearchStrategy(ESearchStrategy strategy);
+        ESearchStrategy SearchStrategy() const noexcept;
+        // vertices settled by the last Dijkstra or AStar search, 0 after Raptor
+        std::size_t SettledVertexCount() const noexcept;
+
         std::size_t NodeCount() const noexcept override;
         std::shared_ptr<CStreetMap::SNode> SortedNodeByIndex(std::size_t index) const noexcept override;
 
         double FindShortestPath(TNodeID src, TNodeID dest, std::vector< TNodeID > &path) override;
+        // A trip either walks and rides buses or bikes all the way. There are
+        // no edges between the walk and bike layers, switching at a node
+        // would leave a bike behind or need one waiting there, and a bike
+        // cannot be taken on the bus.
         double FindFastestPath(TNodeID src, TNodeID dest, std::vector< TTripStep > &path) override;
         bool GetPathDescription(const std::vector< TTripStep > &path, std::vector< std::string > &desc) const override;
+
+        // Returns the journeys from src to dest that no other journey beats
+        // on travel time, rides and walking time together, ordered by rides.
+        // Walking has to differ by a minute to tell two journeys apart.
+        // The search runs over the bus routes like the Raptor strategy.
+        std::vector< SPathOption > FindFastestPathOptions(TNodeID src, TNodeID dest);
+
+        // Batch queries are spread across threadcount worker threads, 0 uses
+        // one per hardware thread. Returns the result of each query in order.
+        std::vector<double> FindShortestPaths(const std::vector< TQuery > &queries, std::vector< std::vector< TNodeID > > &paths, std::size_t threadcount = 0);
+        std::vector<double> FindFastestPaths(const std::vector< TQuery > &queries, std::vector< std::vector< TTripStep > > &paths, std::size_t threadcount = 0);
 };
 
 #endif
@@ -1,17 +1,12 @@
 #ifndef FILEDATASINK_H
 #define FILEDATASINK_H
 
-#include "DataSink.h"
-#include <fstream>
+#include "BufferedDataSink.h"
+#include <string>
 
-class CFileDataSink : public CDataSink{
-    private:
-        std::ofstream DFile;
+class CFileDataSink : public CBufferedDataSink{
     public:
-        CFileDataSink(const std::string &filename);
-
-        bool Put(const char &ch) noexcept override;
-        bool Write(const std::vector<char> &buf) noexcept override;
+        CFileDataSink(const std::string &filename, std::size_t capacity = DefaultCapacity);
 };
 
 #endif
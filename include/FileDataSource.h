@@ -7,6 +7,10 @@
 class CFileDataSource : public CDataSource{
     private:
         std::ifstream DFile;
+        std::vector<char> DBuffer;
+        std::size_t DIndex;
+
+        bool Fill();
     public:
         CFileDataSource(const std::string &filename);
 
@@ -0,0 +1,34 @@
+#ifndef MEMORYMAPPEDDATASOURCE_H
+#define MEMORYMAPPEDDATASOURCE_H
+
+#include "DataSource.h"
+#include <string>
+
+// Data source over a memory mapped file. Besides the character interface it
+// hands out views of the mapped bytes, so a parser can consume the file in
+// large blocks without copying it or calling Get per character.
+class CMemoryMappedDataSource : public CDataSource{
+    private:
+        const char *DData;
+        std::size_t DSize;
+        std::size_t DIndex;
+    public:
+        CMemoryMappedDataSource(const std::string &filename);
+        ~CMemoryMappedDataSource();
+
+        CMemoryMappedDataSource(const CMemoryMappedDataSource &) = delete;
+        CMemoryMappedDataSource &operator=(const CMemoryMappedDataSource &) = delete;
+
+        // false if the file could not be opened or mapped, empty files included
+        bool Valid() const noexcept;
+
+        bool End() const noexcept override;
+        bool Get(char &ch) noexcept override;
+        bool Peek(char &ch) noexcept override;
+        bool Read(std::vector<char> &buf, std::size_t count) noexcept override;
+
+        // points data at up to count unread bytes of the mapping and skips past them
+        bool ReadView(const char *&data, std::size_t &length, std::size_t count) noexcept;
+};
+
+#endif
@@ -3,6 +3,8 @@
 
 #include "XMLReader.h"
 #include "StreetMap.h"
+#include <string>
+#include <vector>
 
 class COpenStreetMap : public CStreetMap{
     private:
@@ -10,7 +12,21 @@ class COpenStreetMap : public CStreetMap{
         std::unique_ptr<SImplementation> DImplementation;
 
     public:
-        COpenStreetMap(std::shared_ptr<CXMLReader> src);
+        // decides what the constructor keeps while parsing, the default keeps
+        // everything. Nodes are always kept so stops can reference them.
+        struct SLoadFilter{
+            // a way is kept only if it has an attribute with one of these
+            // keys, an empty list keeps every way
+            std::vector<std::string> DWayKeys;
+            // attribute keys kept on nodes and ways, an empty list keeps all
+            std::vector<std::string> DAttributeKeys;
+
+            // keeps the ways a planner can route on and the attributes it reads
+            static SLoadFilter Routing();
+        };
+
+        COpenStreetMap(std::shared_ptr<CXMLReader> src, const SLoadFilter &filter = SLoadFilter());
+        COpenStreetMap(std::shared_ptr<CDataSource> src, const SLoadFilter &filter = SLoadFilter());
         ~COpenStreetMap();
 
         std::size_t NodeCount() const noexcept override;
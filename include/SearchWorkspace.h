@@ -0,0 +1,93 @@
+#ifndef SEARCHWORKSPACE_H
+#define SEARCHWORKSPACE_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <vector>
+
+// Cost, parent and heap storage for one graph search that is kept between
+// queries. Every Reset bumps the version, a label only counts if its stamp
+// matches, so a query pays for the vertices it touches instead of the graph.
+template <typename TParent>
+struct SSearchWorkspace{
+    struct SQueueEntry{
+        double DKey; // priority, the cost plus any estimate of the remaining cost
+        double DCost; // cost when the entry was pushed
+        std::size_t DVertex;
+
+        bool operator>(const SQueueEntry &entry) const{
+            if(DKey != entry.DKey){
+                return DKey > entry.DKey;
+            }
+            if(DCost != entry.DCost){
+                return DCost > entry.DCost;
+            }
+            return DVertex > entry.DVertex;
+        };
+    };
+
+    std::vector<double> DCosts;
+    std::vector<TParent> DParents;
+    std::vector<std::uint32_t> DStamps;
+    std::uint32_t DVersion = 0;
+    std::vector<SQueueEntry> DHeap;
+
+    // Starts a new search over vertexcount vertices
+    void Reset(std::size_t vertexcount){
+        if(DStamps.size() < vertexcount){
+            DCosts.resize(vertexcount);
+            DParents.resize(vertexcount);
+            DStamps.resize(vertexcount, 0);
+        }
+        if(++DVersion == 0){
+            // stamps from 2^32 searches ago would look current again
+            std::fill(DStamps.begin(), DStamps.end(), 0);
+            DVersion = 1;
+        }
+        DHeap.clear();
+    };
+
+    bool Reached(std::size_t vertex) const{
+        return DStamps[vertex] == DVersion;
+    };
+
+    // Returns infinity for vertices this search has not reached
+    double Cost(std::size_t vertex) const{
+        return Reached(vertex) ? DCosts[vertex] : std::numeric_limits<double>::infinity();
+    };
+
+    const TParent &Parent(std::size_t vertex) const{
+        return DParents[vertex];
+    };
+
+    void Set(std::size_t vertex, double cost, const TParent &parent){
+        DStamps[vertex] = DVersion;
+        DCosts[vertex] = cost;
+        DParents[vertex] = parent;
+    };
+
+    void Push(double key, double cost, std::size_t vertex){
+        DHeap.push_back({key, cost, vertex});
+        std::push_heap(DHeap.begin(), DHeap.end(), std::greater<>());
+    };
+
+    bool Empty() const{
+        return DHeap.empty();
+    };
+
+    const SQueueEntry &Top() const{
+        return DHeap.front();
+    };
+
+    SQueueEntry Pop(){
+        std::pop_heap(DHeap.begin(), DHeap.end(), std::greater<>());
+        SQueueEntry Entry = DHeap.back();
+        DHeap.pop_back();
+        return Entry;
+    };
+};
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef SNAPSHOTREADER_H
+#define SNAPSHOTREADER_H
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <type_traits>
+
+// Reads a snapshot written by CSnapshotWriter from a memory mapped file, so
+// the pages are shared by every process that loads the same snapshot. Every
+// read fails once the data runs out.
+class CSnapshotReader{
+    private:
+        struct SImplementation;
+        std::unique_ptr<SImplementation> DImplementation;
+
+        bool ReadBytes(void *data, std::size_t size);
+        bool Align();
+
+    public:
+        CSnapshotReader(const std::string &filename);
+        ~CSnapshotReader();
+
+        bool Valid() const;
+        uint32_t Version() const;
+        // bytes left to read, bounds any count taken from the snapshot
+        std::size_t Remaining() const;
+
+        template <typename T>
+        bool ReadValue(T &value){
+            static_assert(std::is_trivially_copyable<T>::value, "snapshot values must be trivially copyable");
+            return ReadBytes(&value, sizeof(T));
+        };
+
+        template <typename T>
+        bool ReadArray(std::vector<T> &values){
+            static_assert(std::is_trivially_copyable<T>::value, "snapshot arrays must be trivially copyable");
+            uint64_t Count;
+            if(!ReadValue(Count) || !Align() || Count > Remaining() / sizeof(T)){
+                return false;
+            }
+            values.resize(Count);
+            return ReadBytes(values.data(), Count * sizeof(T));
+        };
+
+        bool ReadString(std::string &str);
+};
+
+#endif
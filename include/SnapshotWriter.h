@@ -0,0 +1,44 @@
+#ifndef SNAPSHOTWRITER_H
+#define SNAPSHOTWRITER_H
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <type_traits>
+#include "DataSink.h"
+
+// Writes the binary snapshot format read back by CSnapshotReader. Values are
+// stored in native byte order and arrays are aligned to 8 bytes so a mapped
+// snapshot can be read in place.
+class CSnapshotWriter{
+    private:
+        struct SImplementation;
+        std::unique_ptr<SImplementation> DImplementation;
+
+        bool WriteBytes(const void *data, std::size_t size);
+        bool Align();
+
+    public:
+        static constexpr uint32_t Magic = 0x504E5353; // "SSNP"
+
+        CSnapshotWriter(std::shared_ptr< CDataSink > sink, uint32_t version);
+        ~CSnapshotWriter();
+
+        template <typename T>
+        bool WriteValue(const T &value){
+            static_assert(std::is_trivially_copyable<T>::value, "snapshot values must be trivially copyable");
+            return WriteBytes(&value, sizeof(T));
+        };
+
+        template <typename T>
+        bool WriteArray(const std::vector<T> &values){
+            static_assert(std::is_trivially_copyable<T>::value, "snapshot arrays must be trivially copyable");
+            return WriteValue(uint64_t(values.size())) && Align() && WriteBytes(values.data(), values.size() * sizeof(T));
+        };
+
+        bool WriteString(const std::string &str);
+        bool Flush();
+};
+
+#endif
@@ -1,13 +1,12 @@
 #ifndef STANDARDDATASINK_H
 #define STANDARDDATASINK_H
 
-#include "DataSink.h"
+#include "BufferedDataSink.h"
 
-class CStandardDataSink : public CDataSink{
-    private:
+// writes to standard output, a line at a time when it is a terminal
+class CStandardDataSink : public CBufferedDataSink{
     public:
-        bool Put(const char &ch) noexcept override;
-        bool Write(const std::vector<char> &buf) noexcept override;
+        CStandardDataSink(std::size_t capacity = DefaultCapacity);
 };
 
 #endif
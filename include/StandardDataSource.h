@@ -5,10 +5,17 @@
 
 class CStandardDataSource : public CDataSource{
     private:
+        std::vector<char> DBuffer;
+        std::size_t DIndex = 0;
+        bool DEnded = false;
+
+        bool Fill() noexcept;
     public:
         bool End() const noexcept override;
         bool Get(char &ch) noexcept override;
         bool Peek(char &ch) noexcept override;
+        // returns what is already buffered or a single read of standard input,
+        // so an interactive session is never blocked waiting for count bytes
         bool Read(std::vector<char> &buf, std::size_t count) noexcept override;
 };
 
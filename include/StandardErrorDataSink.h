@@ -1,13 +1,12 @@
 #ifndef STANDARDERRORDATASINK_H
 #define STANDARDERRORDATASINK_H
 
-#include "DataSink.h"
+#include "BufferedDataSink.h"
 
-class CStandardErrorDataSink : public CDataSink{
-    private:
+// writes to standard error, always a line at a time so messages show up promptly
+class CStandardErrorDataSink : public CBufferedDataSink{
     public:
-        bool Put(const char &ch) noexcept override;
-        bool Write(const std::vector<char> &buf) noexcept override;
+        CStandardErrorDataSink(std::size_t capacity = DefaultCapacity);
 };
 
 #endif
@@ -5,6 +5,16 @@
 #include "XMLEntity.h"
 #include "DataSource.h"
 
+// Receives parser events straight from Expat. The name and the null
+// terminated name/value attribute array are only valid during the call.
+class CXMLHandler{
+    public:
+        virtual ~CXMLHandler(){};
+        virtual void StartElement(const char *name, const char **attributes) = 0;
+        virtual void EndElement(const char *name) = 0;
+        virtual void CharData(const char * /*data*/, int /*length*/){}
+};
+
 class CXMLReader{
     private:
         struct SImplementation;
@@ -16,6 +26,9 @@ class CXMLReader{
     
         virtual bool End() const;
         virtual bool ReadEntity(SXMLEntity &entity, bool skipcdata = false);
+        // hands the rest of the document to handler without building entities,
+        // returns false if the document is malformed
+        virtual bool Parse(CXMLHandler &handler);
 };
 
 #endif
@@ -0,0 +1,96 @@
+#include "BufferedDataSink.h"
+#include <algorithm>
+#include <cerrno>
+#include <sys/uio.h>
+#include <unistd.h>
+
+CBufferedDataSink::CBufferedDataSink(int descriptor, bool ownsdescriptor, std::size_t capacity, bool linebuffered){
+    DDescriptor = descriptor;
+    DOwnsDescriptor = ownsdescriptor;
+    DLineBuffered = linebuffered;
+    DGood = descriptor >= 0;
+    DCapacity = capacity;
+    DBuffer.reserve(capacity);
+}
+
+CBufferedDataSink::~CBufferedDataSink(){
+    Flush();
+    if(DOwnsDescriptor && DDescriptor >= 0){
+        close(DDescriptor);
+    }
+}
+
+// writes the buffered bytes followed by data, as one writev while both fit
+// in a single call, then empties the buffer
+bool CBufferedDataSink::WriteThrough(const char *data, std::size_t length) noexcept{
+    struct iovec Vectors[2];
+    Vectors[0].iov_base = DBuffer.data();
+    Vectors[0].iov_len = DBuffer.size();
+    Vectors[1].iov_base = const_cast<char *>(data);
+    Vectors[1].iov_len = length;
+    int First = 0;
+    while(DGood){
+        while(First < 2 && !Vectors[First].iov_len){
+            First++;
+        }
+        if(First == 2){
+            break;
+        }
+        ssize_t Written = writev(DDescriptor, Vectors + First, 2 - First);
+        if(Written < 0){
+            DGood = errno == EINTR;
+            continue;
+        }
+        // skip past what a partial write managed to send
+        while(Written > 0){
+            std::size_t Step = std::min<std::size_t>(Written, Vectors[First].iov_len);
+            Vectors[First].iov_base = static_cast<char *>(Vectors[First].iov_base) + Step;
+            Vectors[First].iov_len -= Step;
+            Written -= Step;
+            if(!Vectors[First].iov_len){
+                First++;
+            }
+        }
+    }
+    DBuffer.clear();
+    return DGood;
+}
+
+std::size_t CBufferedDataSink::Capacity() const noexcept{
+    return DCapacity;
+}
+
+bool CBufferedDataSink::Put(const char &ch) noexcept{
+    if(!DGood){
+        return false;
+    }
+    if(DBuffer.size() >= DCapacity){
+        return WriteThrough(&ch, 1);
+    }
+    DBuffer.push_back(ch);
+    if(DBuffer.size() >= DCapacity || (DLineBuffered && ch == '\n')){
+        return Flush();
+    }
+    return true;
+}
+
+bool CBufferedDataSink::Write(const std::vector<char> &buf) noexcept{
+    if(!DGood){
+        return false;
+    }
+    if(DBuffer.size() + buf.size() > DCapacity){
+        return WriteThrough(buf.data(), buf.size());
+    }
+    DBuffer.insert(DBuffer.end(), buf.begin(), buf.end());
+    if(DBuffer.size() >= DCapacity || (DLineBuffered && std::find(buf.begin(), buf.end(), '\n') != buf.end())){
+        return Flush();
+    }
+    return true;
+}
+
+bool CBufferedDataSink::Flush() noexcept{
+    if(DBuffer.empty()){
+        return DGood;
+    }
+    return WriteThrough(nullptr, 0);
+}
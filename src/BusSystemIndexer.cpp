@@ -10,17 +10,51 @@
 
 struct CBusSystemIndexer::SImplementation{
     std::shared_ptr<CBusSystem> BusSystem;
-    //list of stop IDS
-    mutable std::vector<CBusSystem::TStopID> StopID;
-    //list of route Names
-    mutable std::vector<std::string> RouteNames;
-    //checking if Stop IDs and Route Names are already sorted
-    mutable bool SSorted = false;
-    mutable bool RSorted = false;
-
-    
+    //sorted list of stop IDS
+    std::vector<CBusSystem::TStopID> StopID;
+    //sorted list of route Names
+    std::vector<std::string> RouteNames;
+    //routes in bus system order
+    std::vector<std::shared_ptr<SRoute>> Routes;
+    //first stop at each node
+    std::unordered_map<TNodeID, std::shared_ptr<SStop>> StopsByNodeID;
+    //route index and position of every visit to a stop, ordered by route then position
+    std::unordered_map<CBusSystem::TStopID, std::vector<std::pair<std::size_t, std::size_t>>> StopVisits;
+
+    //both lists are sorted up front so the indexer is never written after
+    //construction and can be shared between threads
     SImplementation(std::shared_ptr<CBusSystem> bussytem)
-        : BusSystem(bussytem){}
+        : BusSystem(bussytem){
+        if (!BusSystem) {
+            return;
+        }
+        //goes through all the stops
+        for (size_t i = 0; i < BusSystem->StopCount(); i++) {
+            //the stop
+            auto stop = BusSystem->StopByIndex(i);
+            //if there is a stop add it to the list of ids
+            if (stop) {
+                StopID.push_back(stop->ID());
+                //a node keeps the first stop found at it
+                StopsByNodeID.emplace(stop->NodeID(), stop);}
+        }
+        //sort all the stop IDs
+        std::sort(StopID.begin(), StopID.end());
+        //goes through all the routes
+        for (size_t i = 0; i < BusSystem->RouteCount(); i++) {
+            //getting route
+            auto route = BusSystem->RouteByIndex(i);
+            //if there is a route add the name to the lsit
+            if (route) RouteNames.push_back(route->Name());
+            Routes.push_back(route);
+            //record where the route visits each stop
+            for (size_t j = 0; route && j < route->StopCount(); j++) {
+                StopVisits[route->GetStopID(j)].emplace_back(i, j);
+            }
+        }
+        //sorting the route Names
+        std::sort(RouteNames.begin(), RouteNames.end());
+    }
 
     std::size_t StopCount() const{
         return BusSystem ? BusSystem->StopCount() : 0;
@@ -32,112 +66,66 @@ struct CBusSystemIndexer::SImplementation{
 
 
     std::shared_ptr<SStop> SortedStopByIndex(std::size_t index) const {
-        size_t count = BusSystem->StopCount();
         //returns null if the index is out of bounds
-        if(index >= count) {
-        return nullptr;
-        }
-
-        //checking if it is sorted (only sort once)
-        if (!SSorted) {  
-            //clear if anything is in there
-            StopID.clear();
-            //goes through all the stops
-            for (size_t i = 0; i < count; i++) {
-                //the stop
-                auto stop = BusSystem->StopByIndex(i);
-                //if there is a stop add it to the list of ids
-                if (stop) {
-                    StopID.push_back(stop->ID());}
-            }
-            //sort all the stop IDs
-            std::sort(StopID.begin(), StopID.end());
-            SSorted = true;
-        }
         return (index < StopID.size()) ? BusSystem->StopByID(StopID[index]) : nullptr;
     }
     
 
     std::shared_ptr<SRoute> SortedRouteByIndex(std::size_t index) const {
-        size_t count = BusSystem->StopCount();
         //returns null if the index is out of bounds
-        if(index >= count) {
-        return nullptr;
-        }
-        //checking if it is sorted (only sort once)
-        if (!RSorted) {  
-            //clear if anything is in there
-            RouteNames.clear();
-            //goes through all the routes
-            for (size_t i = 0; i < count; i++) {
-                //getting route
-                auto route = BusSystem->RouteByIndex(i);
-                //if there is a route add the name to the lsit
-                if (route) RouteNames.push_back(route->Name());
-            }
-            //sorting the route Names
-            std::sort(RouteNames.begin(), RouteNames.end());
-            RSorted = true;
-        }
-    
         return (index < RouteNames.size()) ? BusSystem->RouteByName(RouteNames[index]) : nullptr;
     }
 
 
 
     std::shared_ptr<SStop> StopByNodeID(TNodeID id) const{
-        size_t count = BusSystem->StopCount();
-        //going through each stop
-        for(size_t i = 0; i < count; i++){
-            auto stop = BusSystem->StopByIndex(i);
-            //if it exists
-            if(stop){
-                //checking if it is the right node ID
-                if(stop->NodeID() == id){
-                    return stop;
-                }
-            }
+        auto search = StopsByNodeID.find(id);
+        return (search != StopsByNodeID.end()) ? search->second : nullptr;
+    }
+
+    //returns the visits of the stop at the node, or nullptr if there is no
+    //stop there or no route visits it
+    const std::vector<std::pair<std::size_t, std::size_t>> *VisitsByNodeID(TNodeID id) const{
+        auto stop = StopsByNodeID.find(id);
+        if (stop == StopsByNodeID.end()) {
+            return nullptr;
         }
-        return nullptr;
+        auto visits = StopVisits.find(stop->second->ID());
+        return (visits != StopVisits.end()) ? &visits->second : nullptr;
     }
 
-    //checks if there is a route hetween the start and destinations
+    //checks if there is a route hetween the start and destinations, a route
+    //counts if it visits the start no later than it visits the destination
     bool RoutesByNodeIDs(TNodeID src, TNodeID dest,
         std::unordered_set<std::shared_ptr<SRoute> > &routes) const {
-        // Getting the start and end node
-        auto start = StopByNodeID(src);
-        auto end = StopByNodeID(dest);
-        
-        // Checking if it exists
-        if (!start || !end) return false;
-        
-        // Getting the ID of both nodes
-        CBusSystem::TStopID startID = start->ID();
-        CBusSystem::TStopID endID = end->ID();
-    
-        for (size_t routeIndex = 0, allroutes = BusSystem->RouteCount(); 
-            routeIndex < allroutes; ++routeIndex) {
-            auto route = BusSystem->RouteByIndex(routeIndex);
-            if (!route) continue;
-    
-            //if starrt stop is found
-            CBusSystem::TStopID first = 0;  
-    
-            for (size_t stopIndex = 0, allstops = route->StopCount(); 
-                stopIndex < allstops; ++stopIndex) {
-                CBusSystem::TStopID currentStopID = route->GetStopID(stopIndex);
-                //if we foudn the start stop
-                if (currentStopID == startID) {
-                    first = startID; 
+        auto from = VisitsByNodeID(src);
+        auto to = VisitsByNodeID(dest);
+        if (!from || !to) return false;
+
+        //both lists are ordered by route, so walk them together
+        auto start = from->begin();
+        auto end = to->begin();
+        while (start != from->end() && end != to->end()) {
+            if (start->first < end->first) {
+                ++start;
+            } else if (end->first < start->first) {
+                ++end;
+            } else {
+                //the first visit to the start and the last visit to the end
+                std::size_t routeIndex = start->first;
+                std::size_t earliest = start->second;
+                std::size_t latest = end->second;
+                while (start != from->end() && start->first == routeIndex) ++start;
+                while (end != to->end() && end->first == routeIndex) {
+                    latest = end->second;
+                    ++end;
                 }
-                //check for end
-                if (first && currentStopID == endID) {  
-                    routes.insert(route);
-                    break;
+                if (earliest <= latest) {
+                    routes.insert(Routes[routeIndex]);
                 }
             }
         }
-        
+
         return !routes.empty();
     }
     
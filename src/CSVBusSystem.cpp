@@ -1,8 +1,8 @@
 #include <memory>         
 #include <vector>          
 #include <string>          
+#include <string_view>
 #include <unordered_map>  
-#include <iostream> 
 #include "CSVBusSystem.h" 
 #include "DSVReader.h"    
 #include "XMLReader.h"
@@ -21,31 +21,28 @@ struct CCSVBusSystem::SImplementation{
 // Constructor for the CSV Bus System
 CCSVBusSystem::CCSVBusSystem(std::shared_ptr< CDSVReader > stopsrc, std::shared_ptr<CDSVReader > routesrc){
     DImplementation = std::make_unique<SImplementation>();
-    // Temporary vector to hold data from each row of CSV
-    std::vector<std::string> row;  
+    // Fields of each row, views into the reader that are valid until the next row
+    std::vector<std::string_view> row;  
     
     // If stops CSV is provided, process the stops
     if (stopsrc) {
         // Read each row of the stops CSV file
         while (stopsrc->ReadRow(row)) {
-            if (row.size() >= 2) {
-                //make sure info is valid  
-                try {
-                    auto stop = std::make_shared<SStop>();
-
-                    // Convert and store stop ID and node ID from the row data
-                    stop->StopID = std::stoul(row[0]);  
-                    stop->val = std::stoul(row[1]);
-
-                    // Add the stop to the stops map and the list
-                    DImplementation->Stops[stop->StopID] = stop; 
-                    DImplementation->SList.push_back(stop);  
-
-                // Handle any exceptions that occur CANNOT REMOVE
-                } catch (const std::exception& e) {
-                    std::cerr << "Exception caught: " << e.what() << "\n";
-                }
+            TStopID stopID;
+            CStreetMap::TNodeID nodeID;
+            // rows such as the header whose IDs are not numbers are skipped
+            if (row.size() < 2 || !stopsrc->Field(0, stopID) || !stopsrc->Field(1, nodeID)) {
+                continue;
             }
+            auto stop = std::make_shared<SStop>();
+
+            // store stop ID and node ID from the row data
+            stop->StopID = stopID;  
+            stop->val = nodeID;
+
+            // Add the stop to the stops map and the list
+            DImplementation->Stops[stop->StopID] = stop; 
+            DImplementation->SList.push_back(stop);  
         }
     }
 
@@ -53,29 +50,25 @@ CCSVBusSystem::CCSVBusSystem(std::shared_ptr< CDSVReader > stopsrc, std::shared_
     if (routesrc) {
 
         std::unordered_map<std::string, std::shared_ptr<SRoute>> temp;  
+        std::string name; // reused for every row so lookups do not allocate
         // Read each row from the routes CSV
         while (routesrc->ReadRow(row)) {  
-            if (row.size() >= 2) {  
-                //make sure info is valid
-                try {
-                    std::string name = row[0];  
-                    TStopID stopID = std::stoul(row[1]);  
-
-                    // Find or create a route for the name
-                    auto& route = temp[name];  
-                    if (!route) {
-                        route = std::make_shared<SRoute>();
-                        route->RouteName = name;
-                    }
-
-                    // Add the stop ID to the route's list of stops
-                    route->RouteStops.push_back(stopID);  
-
-                // Handle any exceptions that occur CANNOT REMOVE
-                } catch (const std::exception& e) { 
-                    std::cerr << "Exception caught: " << e.what() << "\n";
-                }
+            TStopID stopID;
+            // the header and rows whose stop ID is not a number are skipped
+            if (row.size() < 2 || !routesrc->Field(1, stopID)) {
+                continue;
             }
+            name.assign(row[0]);  
+
+            // Find or create a route for the name
+            auto& route = temp[name];  
+            if (!route) {
+                route = std::make_shared<SRoute>();
+                route->RouteName = name;
+            }
+
+            // Add the stop ID to the route's list of stops
+            route->RouteStops.push_back(stopID);  
         }
         // After reading the CSV, add all routes to the system's routes map and list
         for (const auto& pair : temp) {
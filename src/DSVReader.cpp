@@ -1,85 +1,449 @@
 #include "DSVReader.h"
-#include <sstream>
-#include <iostream>
+#include "MemoryMappedDataSource.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+// returns the first quote, separator or line break in [begin, end), tested
+// 16 bytes at a time where the target has SSE2
+static const char *FindSpecial(const char *begin, const char *end, char separator) {
+#if defined(__SSE2__)
+    const __m128i quotes = _mm_set1_epi8('"');
+    const __m128i separators = _mm_set1_epi8(separator);
+    const __m128i newlines = _mm_set1_epi8('\n');
+    const __m128i returns = _mm_set1_epi8('\r');
+    while (end - begin >= 16) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(begin));
+        __m128i hits = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(block, quotes), _mm_cmpeq_epi8(block, separators)),
+                                    _mm_or_si128(_mm_cmpeq_epi8(block, newlines), _mm_cmpeq_epi8(block, returns)));
+        unsigned mask = unsigned(_mm_movemask_epi8(hits));
+        if (mask) {
+            return begin + __builtin_ctz(mask);
+        }
+        begin += 16;
+    }
+#endif
+    // scalar fallback, also handles the tail shorter than a block
+    while (begin < end && *begin != '"' && *begin != separator && *begin != '\n' && *begin != '\r') {
+        begin++;
+    }
+    return begin;
+}
 
 // handles parsing delimiter-separated values from a data source
 struct CDSVReader::SImplementation {
     std::shared_ptr<CDataSource> InputSource;  // data input stream
     char ColumnSeparator; // character that separates columns
+    std::vector<char> Buffer; // chunk being parsed, the current row is always contiguous in it
+    std::vector<char> Chunk; // next chunk pulled from the source while a row is incomplete
+    std::size_t Position = 0; // next unread character in the buffer
+    std::vector<std::pair<std::size_t, std::size_t>> Spans; // offset from the row start and length of each field
+    std::vector<std::string_view> Fields; // fields of the last row, unescaped in place in the buffer
+
+    // cursors used while parsing a row, all index the buffer
+    std::size_t RowStart = 0; // first character of the row
+    std::size_t FieldStart = 0; // first character of the field being parsed
+    std::size_t Output = 0; // where the next unescaped character of the field goes
+    std::size_t Input = 0; // next character to parse
+
+    // field found by the parallel mode, a view into the mapping unless it
+    // had to be unescaped into the Text of its range
+    struct SParsedField {
+        std::size_t Offset;
+        std::size_t Length;
+        bool Unescaped;
+    };
+
+    // rows of one byte range of the mapping, filled in by a worker thread
+    struct SParsedRange {
+        std::vector<SParsedField> Fields;
+        std::vector<std::size_t> RowEnds; // one past the last field of each row
+        std::string Text; // fields with doubled quotes or text outside their quotes
+        bool Ready = false; // set under ReadyMutex once the range is parsed
+    };
+    const char *MappedData = nullptr; // mapping the parallel mode parses
+    std::vector<std::size_t> RangeStarts; // offset of each byte range, plus the size
+    std::vector<SParsedRange> ParsedRanges;
+    bool Parallel = false; // rows come from ParsedRanges instead of the source
+    std::size_t RangeIndex = 0; // range holding the next row
+    std::size_t RowIndex = 0; // next row within that range
+    std::vector<std::thread> Workers; // parse the ranges while rows are read
+    std::atomic<std::size_t> NextRange = 0; // next range a worker parses
+    std::mutex ReadyMutex;
+    std::condition_variable ReadyCondition; // signalled as each range is parsed
+    std::exception_ptr Failure; // first exception thrown by a worker
+
+    // number of characters pulled from the source at a time
+    static constexpr std::size_t ChunkSize = 65536;
+    // smallest byte range worth handing to a thread of its own
+    static constexpr std::size_t MinimumRangeSize = std::size_t(1) << 20;
 
     // constructor initializes source and delimiter
-    SImplementation(std::shared_ptr<CDataSource> src, char delimiter)
-        : InputSource(std::move(src)), ColumnSeparator(delimiter) {}
-
-    // helper function to handle quoted text logic
-    bool ProcessQuotes(std::string &columnData, bool &insideQuotes) {
-        char nextChar;
-        if (!InputSource->End() && InputSource->Peek(nextChar)) {
-            if (nextChar == '"') {  
-                InputSource->Get(nextChar); // consume one quote, keep one
-                columnData += '"';
-                return false;
+    SImplementation(std::shared_ptr<CDataSource> src, char delimiter, std::size_t threadcount = 1)
+        : InputSource(std::move(src)), ColumnSeparator(delimiter) {
+        if (threadcount != 1) {
+            ParseInParallel(threadcount);
+        }
+    }
+
+    // workers stop after the range they are parsing
+    ~SImplementation() {
+        NextRange = ParsedRanges.size();
+        for (auto &thread : Workers) {
+            thread.join();
+        }
+    }
+
+    // true once the buffer and the source are both used up
+    bool End() {
+        if (Parallel) {
+            SkipUsedRanges();
+            return RangeIndex >= ParsedRanges.size();
+        }
+        return Position >= Buffer.size() && InputSource->End();
+    }
+
+    // calls task for every index below count from threadcount threads, the
+    // calling thread included, and rethrows the first exception a task throws
+    static void RunParallel(std::size_t count, std::size_t threadcount, const std::function<void(std::size_t)> &task) {
+        threadcount = std::min(threadcount, count);
+        std::atomic<std::size_t> next = 0; // next index to hand out
+        std::exception_ptr failure; // first exception thrown by a worker
+        std::mutex failureMutex;
+        auto worker = [&]() {
+            try {
+                for (std::size_t index = next++; index < count; index = next++) {
+                    task(index);
+                }
+            }
+            catch (...) {
+                std::lock_guard<std::mutex> lock(failureMutex);
+                if (!failure) {
+                    failure = std::current_exception();
+                }
+                next = count; // stop the other workers
+            }
+        };
+        std::vector<std::thread> workers;
+        for (std::size_t index = 1; index < threadcount; index++) {
+            workers.emplace_back(worker);
+        }
+        worker();
+        for (auto &thread : workers) {
+            thread.join();
+        }
+        if (failure) {
+            std::rethrow_exception(failure);
+        }
+    }
+
+    // splits a mapped source into byte ranges, moves each range start up to
+    // the next row boundary and starts worker threads that parse the ranges
+    // in file order while rows are read. A quote either toggles quoting or
+    // pairs with its neighbour, so the number of quotes before a position
+    // tells whether a line break there ends a row.
+    void ParseInParallel(std::size_t threadcount) {
+        auto mapped = std::dynamic_pointer_cast<CMemoryMappedDataSource>(InputSource);
+        if (threadcount == 0) {
+            threadcount = std::max(1u, std::thread::hardware_concurrency());
+        }
+        const char *data;
+        std::size_t size;
+        if (!mapped || threadcount == 1 || !mapped->ReadView(data, size, std::size_t(-1))) {
+            return;
+        }
+        std::size_t rangecount = std::max<std::size_t>(1, std::min(threadcount * 4, size / MinimumRangeSize));
+
+        // count the quotes in the evenly split ranges
+        std::vector<std::size_t> quotes(rangecount);
+        RunParallel(rangecount, threadcount, [&](std::size_t index) {
+            quotes[index] = std::count(data + index * size / rangecount, data + (index + 1) * size / rangecount, '"');
+        });
+
+        // a row starts after a line feed, or after a carriage return not
+        // followed by a line feed, when an even number of quotes precede it
+        RangeStarts.assign(rangecount + 1, size);
+        std::size_t quotesBefore = 0;
+        RangeStarts[0] = 0;
+        for (std::size_t index = 1; index < rangecount; index++) {
+            quotesBefore += quotes[index - 1];
+            std::size_t position = index * size / rangecount;
+            bool inside = quotesBefore % 2;
+            while (position < size) {
+                if (!inside && (data[position - 1] == '\n' || (data[position - 1] == '\r' && data[position] != '\n'))) {
+                    break;
+                }
+                inside ^= data[position] == '"';
+                position++;
+            }
+            RangeStarts[index] = position;
+        }
+
+        MappedData = data;
+        ParsedRanges.resize(rangecount);
+        Parallel = true;
+        auto worker = [this]() {
+            for (std::size_t index = NextRange++; index < ParsedRanges.size(); index = NextRange++) {
+                try {
+                    ParseRange(ParsedRanges[index], MappedData + RangeStarts[index], MappedData + RangeStarts[index + 1]);
+                }
+                catch (...) {
+                    std::lock_guard<std::mutex> lock(ReadyMutex);
+                    if (!Failure) {
+                        Failure = std::current_exception();
+                    }
+                }
+                std::lock_guard<std::mutex> lock(ReadyMutex);
+                ParsedRanges[index].Ready = true;
+                ReadyCondition.notify_all();
+            }
+        };
+        for (std::size_t index = 0; index < std::min(threadcount, rangecount); index++) {
+            Workers.emplace_back(worker);
+        }
+    }
+
+    // parses the rows in [position, end) of the mapping like ParseRow. The
+    // text of a field stays a view into the mapping while it is contiguous
+    // there, the first doubled quote or text outside the quotes copies it
+    // into the Text of the range.
+    void ParseRange(SParsedRange &range, const char *position, const char *end) const {
+        while (position < end) {
+            bool insideQuotes = false, rowEnded = false, unescaped = false;
+            const char *fieldStart = position, *textBegin = position, *textEnd = position;
+            std::size_t unescapedStart = range.Text.size(), rowStart = range.Fields.size();
+            // adds [begin, stop) of the mapping to the field being parsed
+            auto append = [&](const char *begin, const char *stop) {
+                if (!unescaped && begin == textEnd) {
+                    textEnd = stop;
+                    return;
+                }
+                if (!unescaped) {
+                    range.Text.append(textBegin, textEnd);
+                    unescaped = true;
+                }
+                range.Text.append(begin, stop);
+            };
+            auto endField = [&]() {
+                if (unescaped) {
+                    range.Fields.push_back({unescapedStart, range.Text.size() - unescapedStart, true});
+                } else {
+                    range.Fields.push_back({std::size_t(textBegin - MappedData), std::size_t(textEnd - textBegin), false});
+                }
+                unescaped = false;
+                unescapedStart = range.Text.size();
+                fieldStart = textBegin = textEnd = position;
+            };
+            while (!rowEnded && position < end) {
+                const char *runEnd = FindSpecial(position, end, ColumnSeparator);
+                if (runEnd > position) {
+                    append(position, runEnd);
+                    position = runEnd;
+                    continue;
+                }
+                char currentChar = *position++;
+                if (currentChar == '"') {
+                    if (position < end && *position == '"') {
+                        append(position - 1, position); // keep one quote, skip the other
+                        position++;
+                    } else {
+                        if (!insideQuotes && position - 1 == fieldStart) {
+                            textBegin = textEnd = position; // the field starts after its opening quote
+                        }
+                        insideQuotes = !insideQuotes;
+                    }
+                } else if (currentChar == ColumnSeparator && !insideQuotes) {
+                    endField();
+                } else if ((currentChar == '\n' || currentChar == '\r') && !insideQuotes) {
+                    rowEnded = true;
+                    if (currentChar == '\r' && position < end && *position == '\n') {
+                        position++;
+                    }
+                } else {
+                    append(position - 1, position);
+                }
+            }
+            // a blank line is a row without fields
+            if ((unescaped ? range.Text.size() > unescapedStart : textEnd > textBegin) || range.Fields.size() > rowStart) {
+                endField();
             }
+            range.RowEnds.push_back(range.Fields.size());
         }
-        insideQuotes = !insideQuotes; // toggle state
+    }
+
+    // moves past ranges whose rows have all been read, waiting for each to
+    // be parsed, and rethrows anything a worker threw
+    void SkipUsedRanges() {
+        while (RangeIndex < ParsedRanges.size()) {
+            std::unique_lock<std::mutex> lock(ReadyMutex);
+            ReadyCondition.wait(lock, [this]() { return ParsedRanges[RangeIndex].Ready || Failure; });
+            if (Failure) {
+                std::rethrow_exception(Failure);
+            }
+            if (RowIndex < ParsedRanges[RangeIndex].RowEnds.size()) {
+                return;
+            }
+            RangeIndex++;
+            RowIndex = 0;
+        }
+    }
+
+    // reads the next row into Fields from whichever mode is in use
+    bool NextRow() {
+        if (!Parallel) {
+            return ParseRow();
+        }
+        Fields.clear();
+        SkipUsedRanges();
+        if (RangeIndex >= ParsedRanges.size()) {
+            return false;
+        }
+        const auto &range = ParsedRanges[RangeIndex];
+        for (std::size_t index = RowIndex ? range.RowEnds[RowIndex - 1] : 0; index < range.RowEnds[RowIndex]; index++) {
+            const auto &field = range.Fields[index];
+            Fields.emplace_back((field.Unescaped ? range.Text.data() : MappedData) + field.Offset, field.Length);
+        }
+        RowIndex++;
         return true;
     }
 
-    // reads a single row of data from the input source
-    bool ReadRow(std::vector<std::string> &row) {
-        row.clear();
-        std::string columnData;
-        bool insideQuotes = false, dataRead = false;
+    // makes the next character available, a row that runs past the end of
+    // the buffer is moved to the front first so it stays contiguous
+    bool More() {
+        if (Input < Buffer.size()) {
+            return true;
+        }
+        if (InputSource->End() || !InputSource->Read(Chunk, ChunkSize)) {
+            return false;
+        }
+        if (RowStart == Buffer.size()) {
+            std::swap(Buffer, Chunk);
+            FieldStart = Output = Input = 0;
+        } else {
+            Buffer.erase(Buffer.begin(), Buffer.begin() + RowStart);
+            FieldStart -= RowStart;
+            Output -= RowStart;
+            Input -= RowStart;
+            Buffer.insert(Buffer.end(), Chunk.begin(), Chunk.end());
+        }
+        RowStart = 0;
+        return true;
+    }
 
-        for (;;) {  // infinite loop, breaks when row is complete
-            char currentChar;
-            if (InputSource->End() || !InputSource->Get(currentChar)) break;
-            dataRead = true;
+    // ends the field being parsed, the next one starts at the next character
+    void EndField() {
+        Spans.emplace_back(FieldStart - RowStart, Output - FieldStart);
+        FieldStart = Output = Input;
+    }
 
-            if (currentChar == '"') {
-                if (ProcessQuotes(columnData, insideQuotes)) continue;
-            } 
-            else if (currentChar == ColumnSeparator && !insideQuotes) {
-                row.push_back(std::move(columnData));
-                columnData.clear();
-            } 
-            else if ((currentChar == '\n' || currentChar == '\r') && !insideQuotes) {
-                if (!columnData.empty() || !row.empty()) {
-                    row.push_back(std::move(columnData));
+    // parses a single row into Fields, a quote toggles quoting and two quotes
+    // in a row stand for one quote character, unescaping happens in place.
+    // A field only moves once it holds two quotes in a row or text outside
+    // its quotes, a plain quoted field is left where it is.
+    bool ParseRow() {
+        Spans.clear();
+        Fields.clear();
+        RowStart = FieldStart = Output = Input = Position;
+        if (!More()) {
+            return false;
+        }
+
+        bool insideQuotes = false, rowEnded = false;
+        while (!rowEnded && More()) {
+            // ordinary characters are moved in one run, usually onto themselves
+            std::size_t runEnd = FindSpecial(Buffer.data() + Input, Buffer.data() + Buffer.size(), ColumnSeparator) - Buffer.data();
+            if (runEnd > Input) {
+                if (Output != Input) {
+                    std::memmove(Buffer.data() + Output, Buffer.data() + Input, runEnd - Input);
                 }
-                if (currentChar == '\r' && !InputSource->End()) {
-                    char nextChar;
-                    if (InputSource->Peek(nextChar) && nextChar == '\n') {
-                        InputSource->Get(nextChar);
+                Output += runEnd - Input;
+                Input = runEnd;
+                continue;
+            }
+            char currentChar = Buffer[Input++];
+            if (currentChar == '"') {
+                if (More() && Buffer[Input] == '"') {
+                    Input++; // consume one quote, keep one
+                    Buffer[Output++] = '"';
+                } else {
+                    if (!insideQuotes && Input - 1 == FieldStart) {
+                        FieldStart = Output = Input; // an opening quote only moves the start of the field
                     }
+                    insideQuotes = !insideQuotes; // toggle state
                 }
-                return true;  // row completed
-            } 
-            else {
-                columnData += currentChar;
+            } else if (currentChar == ColumnSeparator && !insideQuotes) {
+                EndField();
+            } else if ((currentChar == '\n' || currentChar == '\r') && !insideQuotes) {
+                rowEnded = true;  // row completed
+                if (currentChar == '\r' && More() && Buffer[Input] == '\n') {
+                    Input++;
+                }
+            } else {
+                Buffer[Output++] = currentChar;
             }
         }
+        // a blank line is a row without fields
+        if (Output > FieldStart || !Spans.empty()) {
+            EndField();
+        }
+        Position = Input;
 
-        if (!columnData.empty() || !row.empty()) {
-            row.push_back(std::move(columnData));
+        for (const auto &span : Spans) {
+            Fields.emplace_back(Buffer.data() + RowStart + span.first, span.second);
         }
-        return dataRead;
+        return true;
     }
 };
 
 // constructor initializes the DSV reader with a source and delimiter
-CDSVReader::CDSVReader(std::shared_ptr<CDataSource> src, char delimiter)
-    : DImplementation(std::make_unique<SImplementation>(std::move(src), delimiter)) {}
+CDSVReader::CDSVReader(std::shared_ptr<CDataSource> src, char delimiter, std::size_t threadcount)
+    : DImplementation(std::make_unique<SImplementation>(std::move(src), delimiter, threadcount)) {}
 
 // destructor automatically cleans up unique_ptr
 CDSVReader::~CDSVReader() = default;
 
 // checks if all data has been read
 bool CDSVReader::End() const {
-    return DImplementation->InputSource->End();
+    return DImplementation->End();
 }
 
-// reads a row into the provided vector
+// reads a row into the provided vector, existing strings are reused
 bool CDSVReader::ReadRow(std::vector<std::string> &row) {
-    return DImplementation->ReadRow(row);
+    if (!DImplementation->NextRow()) {
+        row.clear();
+        return false;
+    }
+    const auto &fields = DImplementation->Fields;
+    row.resize(fields.size());
+    for (std::size_t index = 0; index < fields.size(); index++) {
+        row[index].assign(fields[index]);
+    }
+    return true;
+}
+
+// reads a row as views into the reader's buffer
+bool CDSVReader::ReadRow(std::vector<std::string_view> &row) {
+    bool success = DImplementation->NextRow();
+    row.assign(DImplementation->Fields.begin(), DImplementation->Fields.end());
+    return success;
+}
+
+// number of fields in the row read last
+std::size_t CDSVReader::FieldCount() const {
+    return DImplementation->Fields.size();
+}
+
+// field of the row read last, empty if index is out of range
+std::string_view CDSVReader::Field(std::size_t index) const {
+    return index < DImplementation->Fields.size() ? DImplementation->Fields[index] : std::string_view();
 }
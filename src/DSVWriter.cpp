@@ -15,54 +15,45 @@ struct CDSVWriter::SImplementation {
     SImplementation(std::shared_ptr<CDataSink> sink, char delimiter, bool quoteAllFields)
         : Sink(std::move(sink)), Delimiter(delimiter), QuoteAll(quoteAllFields) {}
 
+    // characters of the row being written, handed to the sink in one Write
+    std::vector<char> Line;
+
     // writes a row of data to the sink
     bool WriteRow(const std::vector<std::string>& row) {
         // sink is valid
         if (!Sink) {
             return false;  }
-         // Write just a newline for empty rows
-        if (row.empty()) {
-            return Sink->Put('\n'); }
 
+        Line.clear();
         // writes a row of data to the sink
         for (size_t i = 0; i < row.size(); ++i) {
             bool quotes = QuoteAll || row[i].find(Delimiter) != std::string::npos ||
                                row[i].find('"') != std::string::npos || row[i].find('\n') != std::string::npos;
 
             if (quotes) {
-                if (!Sink->Put('"')){
-                    return false; } 
-
+                Line.push_back('"');
                 for (char ch : row[i]) {
+                    // Escape double quotes by duplicating them
                     if (ch == '"') {
-                        // Escape double quotes by duplicating them
-                        if (!Sink->Put('"') || !Sink->Put('"')) {
-                            return false;}
-                    } else {
-                        if (!Sink->Put(ch)) {
-                            return false;}
+                        Line.push_back('"');
                     }
+                    Line.push_back(ch);
                 }
                 // end quoted field
-                if (!Sink->Put('"')) {
-                    return false;  }
-                // if no quoting is needed, write the field character by character
+                Line.push_back('"');
+                // if no quoting is needed, write the field as is
             } else {
-                // Write the field as is
-                for (char ch : row[i]) {
-                    if (!Sink->Put(ch)) {
-                        return false;}
-                }
+                Line.insert(Line.end(), row[i].begin(), row[i].end());
             }
 
             // add delimiter except for last
             if (i < row.size() - 1) {
-                if (!Sink->Put(Delimiter)) {
-                    return false;}
+                Line.push_back(Delimiter);
             }
         }
+        Line.push_back('\n');  // End the row with a newline, empty rows are just the newline
 
-        return Sink->Put('\n');  // End the row with a newline
+        return Sink->Write(Line);
     }
 };
 
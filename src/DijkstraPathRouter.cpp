@@ -1,4 +1,7 @@
 #include "DijkstraPathRouter.h"
+#include "SearchWorkspace.h"
+#include "SnapshotReader.h"
+#include "SnapshotWriter.h"
 #include <unordered_map>
 #include <vector>
 #include <any>
@@ -6,69 +9,707 @@
 #include <queue>
 #include <algorithm>
 #include <memory>
-#include <optional>
+#include <atomic>
+#include <mutex>
 
 //implemetation of the Dijkstra path router
 struct CDijkstraPathRouter::SImplementation {
     using TVertexID = CPathRouter::TVertexID;
 
-    //struct for vertex in graph
-    struct Vertex {
-        std::any tag;
-        std::unordered_map<TVertexID, double> edges;
-        
-        //construct for intializign vertec with a tag
-        Vertex(std::any t) : tag(t) {}
+    //edge waiting to be compacted into the CSR arrays
+    struct SEdge {
+        TVertexID Source;
+        TVertexID Dest;
+        double Weight;
     };
 
-    //list of all vertices
-    std::vector<std::shared_ptr<Vertex>> vertices;
-    //next avaible ID
-    std::size_t nextID = 0;
+    //tag of each vertex, index is the vertex ID
+    std::vector<std::any> tags;
+    //edges added before the graph is frozen, in insertion order
+    std::vector<SEdge> pendingEdges;
+    //true once the edges live in the CSR arrays, concurrent queries may
+    //race to freeze the graph so the first one does it under the mutex
+    std::atomic<bool> frozen = false;
+    std::mutex freezeMutex;
+    //compressed sparse row adjacency, the edges leaving v are
+    //targets/weights[offsets[v]] up to targets/weights[offsets[v+1]]
+    std::vector<std::size_t> offsets;
+    std::vector<TVertexID> targets;
+    std::vector<double> weights;
+    //edges added after freezing that are not already in the CSR arrays
+    std::unordered_map<TVertexID, std::vector<std::pair<TVertexID, double>>> deltaEdges;
+    //reverse CSR adjacency, the edges entering v come from
+    //reverseSources/reverseWeights[reverseOffsets[v]] up to reverseOffsets[v+1]
+    std::vector<std::size_t> reverseOffsets;
+    std::vector<TVertexID> reverseSources;
+    std::vector<double> reverseWeights;
+    //delta overlay edges keyed by their destination
+    std::unordered_map<TVertexID, std::vector<std::pair<TVertexID, double>>> reverseDeltaEdges;
+    //search FindShortestPath runs
+    ESearchMode searchMode = ESearchMode::ContractionHierarchy;
+    //vertices settled by the last query, counted per thread while the
+    //query runs so concurrent queries do not race on it
+    std::atomic<std::size_t> settledCount = 0;
+    static thread_local std::size_t querySettledCount;
+
+    //arc of the contraction hierarchy, middle is the contracted vertex a
+    //shortcut bypasses or InvalidVertexID for an original edge
+    struct SArc {
+        TVertexID Vertex;
+        double Weight;
+        TVertexID Middle;
+    };
+
+    //upward arcs of the hierarchy in CSR form, arcs of v are
+    //arcs[offsets[v]] up to arcs[offsets[v+1]]
+    struct SUpwardGraph {
+        std::vector<std::size_t> Offsets;
+        std::vector<SArc> Arcs;
+    };
+
+    //true while the hierarchy matches the graph
+    bool contracted = false;
+    //contraction order of each vertex, higher is more important
+    std::vector<std::size_t> ranks;
+    //arcs v -> w with w ranked above v
+    SUpwardGraph upwardForward;
+    //arcs u -> v with u ranked above v, stored at v as the arc v <- u
+    SUpwardGraph upwardBackward;
+    //witness searches give up after settling this many vertices, which
+    //only costs an unneeded shortcut
+    static constexpr std::size_t WitnessSettleLimit = 500;
 
     //num of vertices
     std::size_t VertexCount() const noexcept {
-        return vertices.size();
+        return tags.size();
     }
 
     //add a vertec usign the tag and returns ID
     TVertexID AddVertex(std::any tag) noexcept {
-        vertices.push_back(std::make_shared<Vertex>(tag));
-        return nextID++;
+        tags.push_back(tag);
+        //hierarchy no longer covers every vertex
+        contracted = false;
+        if (frozen) {
+            //new vertex has no CSR edges
+            offsets.push_back(targets.size());
+            reverseOffsets.push_back(reverseSources.size());
+        }
+        return tags.size() - 1;
     }
 
     //gets tag using ID
     std::any GetVertexTag(TVertexID id) const noexcept {
-        if (id < vertices.size()) {
-            return vertices[id]->tag;
+        if (id < tags.size()) {
+            return tags[id];
         }
         return std::any();
     }
 
+    //adds or updates a single directed edge
+    void SetEdge(TVertexID src, TVertexID dest, double weight) {
+        //hierarchy is stale until the next Precompute
+        contracted = false;
+        if (!frozen) {
+            pendingEdges.push_back({src, dest, weight});
+            return;
+        }
+        //update in place if the edge was already compacted
+        for (std::size_t index = offsets[src]; index < offsets[src + 1]; index++) {
+            if (targets[index] == dest) {
+                weights[index] = weight;
+                for (std::size_t reverse = reverseOffsets[dest]; reverse < reverseOffsets[dest + 1]; reverse++) {
+                    if (reverseSources[reverse] == src) {
+                        reverseWeights[reverse] = weight;
+                    }
+                }
+                return;
+            }
+        }
+        //otherwise it goes in the delta overlay
+        SetDeltaEdge(deltaEdges[src], dest, weight);
+        SetDeltaEdge(reverseDeltaEdges[dest], src, weight);
+    }
+
+    //adds or updates the overlay edge to vertex
+    static void SetDeltaEdge(std::vector<std::pair<TVertexID, double>> &delta, TVertexID vertex, double weight) {
+        for (auto &edge : delta) {
+            if (edge.first == vertex) {
+                edge.second = weight;
+                return;
+            }
+        }
+        delta.push_back({vertex, weight});
+    }
+
     //adds a edge between to vertices, with given weight
     bool AddEdge(TVertexID src, TVertexID dest, double weight, bool bidir = false) noexcept {
-        if (src >= vertices.size() || dest >= vertices.size() || weight <= 0) {
+        if (src >= tags.size() || dest >= tags.size() || weight <= 0) {
             return false;
         }
         //creates directed edge
-        vertices[src]->edges[dest] = weight;
+        SetEdge(src, dest, weight);
         //adds reverse edge if true
         if (bidir) {
-            vertices[dest]->edges[src] = weight;
+            SetEdge(dest, src, weight);
         }
         return true;
     }
 
-    bool Precompute(std::chrono::steady_clock::time_point deadline) noexcept {
+    //compacts all of the edges into the CSR arrays, a later AddEdge for
+    //the same src and dest replaces the weight of an earlier one
+    void Freeze() {
+        std::vector<SEdge> edges;
+        edges.reserve(targets.size() + pendingEdges.size());
+        //oldest edges first so the stable sort keeps the newest last
+        for (TVertexID src = 0; frozen && src + 1 < offsets.size(); src++) {
+            for (std::size_t index = offsets[src]; index < offsets[src + 1]; index++) {
+                edges.push_back({src, targets[index], weights[index]});
+            }
+        }
+        for (auto &[src, delta] : deltaEdges) {
+            for (auto &[dest, weight] : delta) {
+                edges.push_back({src, dest, weight});
+            }
+        }
+        edges.insert(edges.end(), pendingEdges.begin(), pendingEdges.end());
+        std::stable_sort(edges.begin(), edges.end(), [](const SEdge &a, const SEdge &b) {
+            return a.Source < b.Source || (a.Source == b.Source && a.Dest < b.Dest);
+        });
+
+        offsets.assign(tags.size() + 1, 0);
+        targets.clear();
+        weights.clear();
+        targets.reserve(edges.size());
+        weights.reserve(edges.size());
+        for (std::size_t index = 0; index < edges.size(); index++) {
+            //skip edges replaced by a later one
+            if (index + 1 < edges.size() && edges[index + 1].Source == edges[index].Source && edges[index + 1].Dest == edges[index].Dest) {
+                continue;
+            }
+            offsets[edges[index].Source + 1]++;
+            targets.push_back(edges[index].Dest);
+            weights.push_back(edges[index].Weight);
+        }
+        //prefix sum turns the counts into offsets
+        for (std::size_t index = 1; index < offsets.size(); index++) {
+            offsets[index] += offsets[index - 1];
+        }
+        //reverse arrays are the same edges grouped by destination
+        reverseOffsets.assign(tags.size() + 1, 0);
+        for (auto dest : targets) {
+            reverseOffsets[dest + 1]++;
+        }
+        for (std::size_t index = 1; index < reverseOffsets.size(); index++) {
+            reverseOffsets[index] += reverseOffsets[index - 1];
+        }
+        reverseSources.resize(targets.size());
+        reverseWeights.resize(targets.size());
+        std::vector<std::size_t> next(reverseOffsets.begin(), reverseOffsets.end() - 1);
+        for (TVertexID src = 0; src < tags.size(); src++) {
+            for (std::size_t index = offsets[src]; index < offsets[src + 1]; index++) {
+                auto slot = next[targets[index]]++;
+                reverseSources[slot] = src;
+                reverseWeights[slot] = weights[index];
+            }
+        }
+        pendingEdges.clear();
+        pendingEdges.shrink_to_fit();
+        deltaEdges.clear();
+        reverseDeltaEdges.clear();
+        frozen = true;
+    }
+
+    //runs a witness search from src in the partially contracted graph
+    //skipping the vertex being contracted, fills distances of the touched
+    //vertices up to maxdist
+    void WitnessSearch(const std::vector<std::vector<SArc>> &out, TVertexID src, TVertexID skip, double maxdist,
+                       std::vector<double> &distances, std::vector<TVertexID> &touched) const {
+        std::priority_queue<std::pair<double, TVertexID>, 
+                            std::vector<std::pair<double, TVertexID>>, 
+                            std::greater<>> pq;
+        distances[src] = 0;
+        touched.push_back(src);
+        pq.push({0, src});
+        std::size_t settled = 0;
+        while (!pq.empty() && settled < WitnessSettleLimit) {
+            auto [dist, u] = pq.top();
+            pq.pop();
+            if (dist > distances[u]) {
+                continue; }
+            if (dist > maxdist) {
+                break; }
+            settled++;
+            for (const auto &arc : out[u]) {
+                if (arc.Vertex == skip) {
+                    continue; }
+                double new_dist = dist + arc.Weight;
+                if (new_dist < distances[arc.Vertex]) {
+                    if (distances[arc.Vertex] == std::numeric_limits<double>::infinity()) {
+                        touched.push_back(arc.Vertex); }
+                    distances[arc.Vertex] = new_dist;
+                    pq.push({new_dist, arc.Vertex});
+                }
+            }
+        }
+    }
+
+    //finds the shortcuts needed to contract v, returns how many there are
+    //and fills shortcuts with (src, dest, weight) if it is not null
+    std::size_t FindShortcuts(const std::vector<std::vector<SArc>> &out, const std::vector<std::vector<SArc>> &in, TVertexID v,
+                              std::vector<double> &distances, std::vector<TVertexID> &touched, std::vector<SEdge> *shortcuts) const {
+        std::size_t count = 0;
+        double maxout = 0;
+        for (const auto &outarc : out[v]) {
+            maxout = std::max(maxout, outarc.Weight);
+        }
+        for (const auto &inarc : in[v]) {
+            WitnessSearch(out, inarc.Vertex, v, inarc.Weight + maxout, distances, touched);
+            for (const auto &outarc : out[v]) {
+                if (outarc.Vertex == inarc.Vertex) {
+                    continue; }
+                double weight = inarc.Weight + outarc.Weight;
+                //a witness no longer than the path through v makes it redundant
+                if (distances[outarc.Vertex] > weight) {
+                    count++;
+                    if (shortcuts) {
+                        shortcuts->push_back({inarc.Vertex, outarc.Vertex, weight});
+                    }
+                }
+            }
+            for (auto vertex : touched) {
+                distances[vertex] = std::numeric_limits<double>::infinity(); }
+            touched.clear();
+        }
+        return count;
+    }
+
+    //adds or shortens the arc src -> dest
+    static void UpdateArc(std::vector<SArc> &arcs, TVertexID vertex, double weight, TVertexID middle) {
+        for (auto &arc : arcs) {
+            if (arc.Vertex == vertex) {
+                if (weight < arc.Weight) {
+                    arc.Weight = weight;
+                    arc.Middle = middle;
+                }
+                return;
+            }
+        }
+        arcs.push_back({vertex, weight, middle});
+    }
+
+    //removes the arc to vertex
+    static void RemoveArc(std::vector<SArc> &arcs, TVertexID vertex) {
+        for (std::size_t index = 0; index < arcs.size(); index++) {
+            if (arcs[index].Vertex == vertex) {
+                arcs[index] = arcs.back();
+                arcs.pop_back();
+                return;
+            }
+        }
+    }
+
+    //flattens per vertex arc lists into an upward graph
+    void BuildUpwardGraph(SUpwardGraph &graph, std::vector<std::vector<SArc>> &arcs) const {
+        graph.Offsets.assign(tags.size() + 1, 0);
+        graph.Arcs.clear();
+        for (TVertexID v = 0; v < tags.size(); v++) {
+            graph.Offsets[v] = graph.Arcs.size();
+            graph.Arcs.insert(graph.Arcs.end(), arcs[v].begin(), arcs[v].end());
+            std::vector<SArc>().swap(arcs[v]);
+        }
+        graph.Offsets[tags.size()] = graph.Arcs.size();
+    }
+
+    //contracts the vertices in order of edge difference, returns false if
+    //the deadline passes first
+    bool BuildContractionHierarchy(std::chrono::steady_clock::time_point deadline) {
+        const std::size_t count = tags.size();
+        //remaining graph, arcs only join uncontracted vertices
+        std::vector<std::vector<SArc>> out(count), in(count);
+        for (TVertexID src = 0; src < count; src++) {
+            for (std::size_t index = offsets[src]; index < offsets[src + 1]; index++) {
+                if (targets[index] != src) {
+                    out[src].push_back({targets[index], weights[index], InvalidVertexID});
+                    in[targets[index]].push_back({src, weights[index], InvalidVertexID});
+                }
+            }
+        }
+        //arcs of the hierarchy collected as each vertex is contracted
+        std::vector<std::vector<SArc>> upforward(count), upbackward(count);
+        std::vector<std::size_t> contractedneighbors(count, 0);
+        std::vector<double> distances(count, std::numeric_limits<double>::infinity());
+        std::vector<TVertexID> touched;
+        std::vector<SEdge> shortcuts;
+
+        auto priority = [&](TVertexID v) {
+            double added = FindShortcuts(out, in, v, distances, touched, nullptr);
+            return added - double(out[v].size() + in[v].size()) + contractedneighbors[v];
+        };
+
+        std::priority_queue<std::pair<double, TVertexID>, 
+                            std::vector<std::pair<double, TVertexID>>, 
+                            std::greater<>> order;
+        for (TVertexID v = 0; v < count; v++) {
+            if ((v & 0xff) == 0 && std::chrono::steady_clock::now() > deadline) {
+                return false; }
+            order.push({priority(v), v});
+        }
+
+        std::vector<std::size_t> newranks(count, 0);
+        std::size_t nextrank = 0;
+        while (!order.empty()) {
+            if ((nextrank & 0xff) == 0 && std::chrono::steady_clock::now() > deadline) {
+                return false; }
+            auto [oldpriority, v] = order.top();
+            order.pop();
+            //lazy update, requeue if the priority got worse than the next one
+            double current = priority(v);
+            if (!order.empty() && current > order.top().first) {
+                order.push({current, v});
+                continue;
+            }
+
+            shortcuts.clear();
+            FindShortcuts(out, in, v, distances, touched, &shortcuts);
+            newranks[v] = nextrank++;
+            //everything still attached to v is ranked above it
+            upforward[v] = out[v];
+            upbackward[v] = in[v];
+            for (const auto &arc : out[v]) {
+                RemoveArc(in[arc.Vertex], v);
+                contractedneighbors[arc.Vertex]++;
+            }
+            for (const auto &arc : in[v]) {
+                RemoveArc(out[arc.Vertex], v);
+                contractedneighbors[arc.Vertex]++;
+            }
+            std::vector<SArc>().swap(out[v]);
+            std::vector<SArc>().swap(in[v]);
+            for (const auto &shortcut : shortcuts) {
+                UpdateArc(out[shortcut.Source], shortcut.Dest, shortcut.Weight, v);
+                UpdateArc(in[shortcut.Dest], shortcut.Source, shortcut.Weight, v);
+            }
+        }
+
+        ranks = std::move(newranks);
+        BuildUpwardGraph(upwardForward, upforward);
+        BuildUpwardGraph(upwardBackward, upbackward);
+        contracted = true;
         return true;
     }
 
-    //Dijkstra's algorithm to find shortest path
+    //returns the middle of the hierarchy arc src -> dest
+    TVertexID ArcMiddle(TVertexID src, TVertexID dest) const {
+        if (ranks[src] < ranks[dest]) {
+            for (std::size_t index = upwardForward.Offsets[src]; index < upwardForward.Offsets[src + 1]; index++) {
+                if (upwardForward.Arcs[index].Vertex == dest) {
+                    return upwardForward.Arcs[index].Middle; }
+            }
+        }
+        else {
+            for (std::size_t index = upwardBackward.Offsets[dest]; index < upwardBackward.Offsets[dest + 1]; index++) {
+                if (upwardBackward.Arcs[index].Vertex == src) {
+                    return upwardBackward.Arcs[index].Middle; }
+            }
+        }
+        return InvalidVertexID;
+    }
+
+    //appends the original vertices of the arc src -> dest after src
+    void UnpackArc(TVertexID src, TVertexID dest, TVertexID middle, std::vector<TVertexID> &path) const {
+        //stack of arcs still to expand, top is the next one along the path
+        std::vector<std::pair<TVertexID, TVertexID>> stack;
+        stack.push_back({src, dest});
+        TVertexID first = middle;
+        while (!stack.empty()) {
+            auto [from, to] = stack.back();
+            stack.pop_back();
+            TVertexID via = first != InvalidVertexID ? first : ArcMiddle(from, to);
+            first = InvalidVertexID;
+            if (via == InvalidVertexID) {
+                path.push_back(to);
+            }
+            else {
+                stack.push_back({via, to});
+                stack.push_back({from, via});
+            }
+        }
+    }
+
+    //returns the weight of the original edge src -> dest
+    double EdgeWeight(TVertexID src, TVertexID dest) const {
+        for (std::size_t index = offsets[src]; index < offsets[src + 1]; index++) {
+            if (targets[index] == dest) {
+                return weights[index]; }
+        }
+        auto delta = deltaEdges.find(src);
+        if (delta != deltaEdges.end()) {
+            for (const auto &[vertex, weight] : delta->second) {
+                if (vertex == dest) {
+                    return weight; }
+            }
+        }
+        return std::numeric_limits<double>::infinity();
+    }
+
+    //sums the edges along path in order, matching a forward search
+    double PathDistance(const std::vector<TVertexID> &path) const {
+        double distance = 0.0;
+        for (std::size_t index = 1; index < path.size(); index++) {
+            distance += EdgeWeight(path[index - 1], path[index]);
+        }
+        return distance;
+    }
+
+    //bidirectional upward search over the contraction hierarchy
+    double FindContractedPath(TVertexID src, TVertexID dest, std::vector<TVertexID>& path) {
+        const double infinity = std::numeric_limits<double>::infinity();
+        //parent is the previous vertex toward the search origin and the middle of that arc
+        static thread_local SSearchWorkspace<std::pair<TVertexID, TVertexID>> workspaces[2];
+        const SUpwardGraph *graphs[2] = {&upwardForward, &upwardBackward};
+        double best = infinity;
+        TVertexID meet = InvalidVertexID;
+
+        for (auto &workspace : workspaces) {
+            workspace.Reset(tags.size());
+        }
+        workspaces[0].Set(src, 0, {InvalidVertexID, InvalidVertexID});
+        workspaces[1].Set(dest, 0, {InvalidVertexID, InvalidVertexID});
+        workspaces[0].Push(0, 0, src);
+        workspaces[1].Push(0, 0, dest);
+        for (int side = 0;; side ^= 1) {
+            //each side stops once it cannot improve the best meeting point
+            bool active[2] = {!workspaces[0].Empty() && workspaces[0].Top().DKey < best, !workspaces[1].Empty() && workspaces[1].Top().DKey < best};
+            if (!active[0] && !active[1]) {
+                break; }
+            if (!active[side]) {
+                continue; }
+            auto &workspace = workspaces[side];
+            auto entry = workspace.Pop();
+            double dist = entry.DCost;
+            TVertexID u = entry.DVertex;
+            if (dist > workspace.Cost(u)) {
+                continue; }
+            querySettledCount++;
+            double other = workspaces[side ^ 1].Cost(u);
+            if (other != infinity && dist + other < best) {
+                best = dist + other;
+                meet = u;
+            }
+            const SUpwardGraph &graph = *graphs[side];
+            for (std::size_t index = graph.Offsets[u]; index < graph.Offsets[u + 1]; index++) {
+                const SArc &arc = graph.Arcs[index];
+                double new_dist = dist + arc.Weight;
+                if (new_dist < workspace.Cost(arc.Vertex)) {
+                    workspace.Set(arc.Vertex, new_dist, {u, arc.Middle});
+                    workspace.Push(new_dist, new_dist, arc.Vertex);
+                }
+            }
+        }
+        if (meet == InvalidVertexID) {
+            return NoPathExists;
+        }
+
+        //forward half, collected from the meeting point back to src
+        std::vector<std::pair<TVertexID, TVertexID>> forwardarcs;
+        for (TVertexID at = meet; at != src; at = workspaces[0].Parent(at).first) {
+            forwardarcs.push_back({workspaces[0].Parent(at).first, at});
+        }
+        path.push_back(src);
+        for (auto arc = forwardarcs.rbegin(); arc != forwardarcs.rend(); ++arc) {
+            UnpackArc(arc->first, arc->second, workspaces[0].Parent(arc->second).second, path);
+        }
+        //backward half, previous points toward dest
+        for (TVertexID at = meet; at != dest; at = workspaces[1].Parent(at).first) {
+            UnpackArc(at, workspaces[1].Parent(at).first, workspaces[1].Parent(at).second, path);
+        }
+
+        //sum the original edges in path order so the result matches a plain search
+        return PathDistance(path);
+    }
+
+    //writes the frozen graph and the hierarchy, the tags are left to the caller
+    bool WriteSnapshot(CSnapshotWriter &writer) {
+        if (!frozen) {
+            Freeze();
+        }
+        return writer.WriteValue(uint64_t(tags.size())) &&
+               writer.WriteArray(offsets) && writer.WriteArray(targets) && writer.WriteArray(weights) &&
+               writer.WriteArray(reverseOffsets) && writer.WriteArray(reverseSources) && writer.WriteArray(reverseWeights) &&
+               writer.WriteValue(uint8_t(contracted)) && writer.WriteArray(ranks) &&
+               writer.WriteArray(upwardForward.Offsets) && writer.WriteArray(upwardForward.Arcs) &&
+               writer.WriteArray(upwardBackward.Offsets) && writer.WriteArray(upwardBackward.Arcs);
+    }
+
+    //checks that offsets describe count rows of vertices that are all below count
+    template <typename TVertexList>
+    static bool ValidRows(const std::vector<std::size_t> &rowoffsets, const std::vector<TVertexList> &entries, std::size_t count,
+                          TVertexID (*vertex)(const TVertexList &)) {
+        if (rowoffsets.size() != count + 1 || rowoffsets.front() != 0 || rowoffsets.back() != entries.size()) {
+            return false; }
+        for (std::size_t index = 1; index < rowoffsets.size(); index++) {
+            if (rowoffsets[index] < rowoffsets[index - 1]) {
+                return false; }
+        }
+        for (const auto &entry : entries) {
+            if (vertex(entry) >= count) {
+                return false; }
+        }
+        return true;
+    }
+
+    //true if no weight is negative, infinite or NaN
+    static bool ValidWeights(const std::vector<double> &entries) {
+        for (auto weight : entries) {
+            if (!(weight >= 0.0 && weight < std::numeric_limits<double>::infinity())) {
+                return false; }
+        }
+        return true;
+    }
+
+    //checks that every arc leads up from its row with a valid weight and that
+    //every shortcut middle ranks below both ends, so unpacking always ends
+    bool ValidUpwardGraph(const SUpwardGraph &graph) const {
+        for (TVertexID v = 0; v + 1 < graph.Offsets.size(); v++) {
+            for (std::size_t index = graph.Offsets[v]; index < graph.Offsets[v + 1]; index++) {
+                const auto &entry = graph.Arcs[index];
+                if (!(entry.Weight >= 0.0 && entry.Weight < std::numeric_limits<double>::infinity()) || ranks[entry.Vertex] <= ranks[v] ||
+                    (entry.Middle != InvalidVertexID && ranks[entry.Middle] >= ranks[v])) {
+                    return false; }
+            }
+        }
+        return true;
+    }
+
+    //replaces the edges with a snapshot of a graph with the same vertices
+    bool ReadSnapshot(CSnapshotReader &reader) {
+        uint64_t count;
+        uint8_t hierarchy;
+        SUpwardGraph forward, backward;
+        if (!reader.ReadValue(count) || count != tags.size() ||
+            !reader.ReadArray(offsets) || !reader.ReadArray(targets) || !reader.ReadArray(weights) ||
+            !reader.ReadArray(reverseOffsets) || !reader.ReadArray(reverseSources) || !reader.ReadArray(reverseWeights) ||
+            !reader.ReadValue(hierarchy) || !reader.ReadArray(ranks) ||
+            !reader.ReadArray(forward.Offsets) || !reader.ReadArray(forward.Arcs) ||
+            !reader.ReadArray(backward.Offsets) || !reader.ReadArray(backward.Arcs)) {
+            return false;
+        }
+        auto plain = [](const TVertexID &vertex) { return vertex; };
+        auto arc = [](const SArc &entry) { return entry.Middle == InvalidVertexID ? entry.Vertex : std::max(entry.Vertex, entry.Middle); };
+        if (!ValidRows<TVertexID>(offsets, targets, count, plain) || weights.size() != targets.size() || !ValidWeights(weights) ||
+            !ValidRows<TVertexID>(reverseOffsets, reverseSources, count, plain) || reverseWeights.size() != targets.size() ||
+            !ValidWeights(reverseWeights)) {
+            return false;
+        }
+        if (hierarchy && (ranks.size() != count || !ValidRows<SArc>(forward.Offsets, forward.Arcs, count, arc) ||
+                          !ValidRows<SArc>(backward.Offsets, backward.Arcs, count, arc) ||
+                          !ValidUpwardGraph(forward) || !ValidUpwardGraph(backward))) {
+            return false;
+        }
+        upwardForward = std::move(forward);
+        upwardBackward = std::move(backward);
+        pendingEdges.clear();
+        deltaEdges.clear();
+        reverseDeltaEdges.clear();
+        contracted = hierarchy;
+        frozen = true;
+        return true;
+    }
+
+    bool Precompute(std::chrono::steady_clock::time_point deadline) noexcept {
+        //merges the delta overlay back into the CSR arrays
+        Freeze();
+        //queries fall back to plain Dijkstra if the hierarchy is not done in time
+        return contracted || BuildContractionHierarchy(deadline);
+    }
+
+    //bidirectional Dijkstra, a forward search from src and a backward search
+    //from dest over the reverse edges until they can no longer improve on
+    //the best meeting point
+    double FindBidirectionalPath(TVertexID src, TVertexID dest, std::vector<TVertexID>& path) {
+        const double infinity = std::numeric_limits<double>::infinity();
+        //parent is the previous vertex toward the origin of each search
+        static thread_local SSearchWorkspace<TVertexID> workspaces[2];
+        double best = infinity;
+        TVertexID meet = InvalidVertexID;
+
+        for (auto &workspace : workspaces) {
+            workspace.Reset(tags.size());
+        }
+        workspaces[0].Set(src, 0, InvalidVertexID);
+        workspaces[1].Set(dest, 0, InvalidVertexID);
+        workspaces[0].Push(0, 0, src);
+        workspaces[1].Push(0, 0, dest);
+        //relaxes u -> v for the forward side or v -> u for the backward side
+        auto relax = [&](int side, TVertexID u, TVertexID v, double weight) {
+            double new_dist = workspaces[side].Cost(u) + weight;
+            if (new_dist < workspaces[side].Cost(v)) {
+                workspaces[side].Set(v, new_dist, u);
+                workspaces[side].Push(new_dist, new_dist, v);
+                double other = workspaces[side ^ 1].Cost(v);
+                if (other != infinity && new_dist + other < best) {
+                    best = new_dist + other;
+                    meet = v;
+                }
+            }
+        };
+        while (!workspaces[0].Empty() && !workspaces[1].Empty()) {
+            //no path through unsettled vertices can beat the best so far
+            if (workspaces[0].Top().DKey + workspaces[1].Top().DKey >= best) {
+                break; }
+            //expand the side with the smaller frontier key
+            int side = workspaces[0].Top().DKey <= workspaces[1].Top().DKey ? 0 : 1;
+            auto entry = workspaces[side].Pop();
+            double dist = entry.DCost;
+            TVertexID u = entry.DVertex;
+            if (dist > workspaces[side].Cost(u)) {
+                continue; }
+            querySettledCount++;
+            const auto &edgeoffsets = side == 0 ? offsets : reverseOffsets;
+            const auto &edgevertices = side == 0 ? targets : reverseSources;
+            const auto &edgeweights = side == 0 ? weights : reverseWeights;
+            for (std::size_t index = edgeoffsets[u]; index < edgeoffsets[u + 1]; index++) {
+                relax(side, u, edgevertices[index], edgeweights[index]);
+            }
+            const auto &deltas = side == 0 ? deltaEdges : reverseDeltaEdges;
+            if (!deltas.empty()) {
+                auto delta = deltas.find(u);
+                if (delta != deltas.end()) {
+                    for (const auto& [v, weight] : delta->second) {
+                        relax(side, u, v, weight);
+                    }
+                }
+            }
+        }
+        if (meet == InvalidVertexID) {
+            return NoPathExists;
+        }
+        for (TVertexID at = meet; at != InvalidVertexID; at = workspaces[0].Parent(at)) {
+            path.push_back(at);
+        }
+        std::reverse(path.begin(), path.end());
+        for (TVertexID at = workspaces[1].Parent(meet); at != InvalidVertexID; at = workspaces[1].Parent(at)) {
+            path.push_back(at);
+        }
+        //sum the edges in path order so the result matches a forward search
+        return PathDistance(path);
+    }
+
+    //queries only read the graph, so any number of threads may search at
+    //once as long as no edges or vertices are being added
     double FindShortestPath(TVertexID src, TVertexID dest, std::vector<TVertexID>& path) noexcept {
+        querySettledCount = 0;
+        double distance = Search(src, dest, path);
+        settledCount = querySettledCount;
+        return distance;
+    }
+
+    //Dijkstra's algorithm to find shortest path
+    double Search(TVertexID src, TVertexID dest, std::vector<TVertexID>& path) {
         //path is emoty
         path.clear();
     
-        if (vertices.empty() || src >= vertices.size() || dest >= vertices.size()) {
+        if (tags.empty() || src >= tags.size() || dest >= tags.size()) {
             return NoPathExists;
         }
         //if same return 0
@@ -76,64 +717,81 @@ struct CDijkstraPathRouter::SImplementation {
             path.push_back(src);
             return 0.0;
         }
-        //priotirty queue
-        std::priority_queue<std::pair<double, TVertexID>, 
-                            std::vector<std::pair<double, TVertexID>>, 
-                            std::greater<>> pq;
-    
-        std::vector<double> distances;
-        std::vector<std::optional<TVertexID>> previous;
-        //distances to infinity
-        distances.assign(vertices.size(), std::numeric_limits<double>::infinity());
-        //track path taken
-        previous.assign(vertices.size(), std::nullopt);
+        //first query freezes the graph if Precompute was not called
+        if (!frozen) {
+            std::lock_guard<std::mutex> lock(freezeMutex);
+            if (!frozen) {
+                Freeze();
+            }
+        }
+        if (searchMode == ESearchMode::ContractionHierarchy && contracted) {
+            return FindContractedPath(src, dest, path);
+        }
+        if (searchMode == ESearchMode::Bidirectional) {
+            return FindBidirectionalPath(src, dest, path);
+        }
+        //distances, previous vertices and the priority queue, reused by
+        //every query on this thread
+        static thread_local SSearchWorkspace<TVertexID> workspace;
+        //every distance starts at infinity
+        workspace.Reset(tags.size());
     
         //dist to source is 0
-        distances[src] = 0;
+        workspace.Set(src, 0, InvalidVertexID);
         //push to priority queue
-        pq.push({0, src});
+        workspace.Push(0, 0, src);
     
-        while (!pq.empty()) {
+        //relaxes a single edge leaving u
+        auto relax = [&](TVertexID u, TVertexID v, double weight) {
+            double new_dist = workspace.Cost(u) + weight;
+            //find the shorter path
+            if (new_dist < workspace.Cost(v)) {
+                workspace.Set(v, new_dist, u);
+                //update the distance intot he queue
+                workspace.Push(new_dist, new_dist, v);
+            }
+        };
+
+        while (!workspace.Empty()) {
             //smallest distance vertex
-            auto [dist, u] = pq.top();
-            pq.pop();
+            auto entry = workspace.Pop();
+            double dist = entry.DCost;
+            TVertexID u = entry.DVertex;
     
-            if (dist > distances[u]) {
+            if (dist > workspace.Cost(u)) {
                 //skip bigger distances
                 continue; }
+            querySettledCount++;
             if (u == dest) {
                 //if it is the destination alreay leave the loop
                 break; }
     
-            for (const auto& [v, weight] : vertices[u]->edges) {
-                double new_dist = distances[u] + weight;
-                //find the shorter path
-                if (new_dist < distances[v]) {
-                    distances[v] = new_dist;
-                    previous[v] = u;
-                    //update the distance intot he queue
-                    pq.push({new_dist, v});
+            for (std::size_t index = offsets[u]; index < offsets[u + 1]; index++) {
+                relax(u, targets[index], weights[index]);
+            }
+            if (!deltaEdges.empty()) {
+                auto delta = deltaEdges.find(u);
+                if (delta != deltaEdges.end()) {
+                    for (const auto& [v, weight] : delta->second) {
+                        relax(u, v, weight);
+                    }
                 }
             }
         }
     
-        if (distances[dest] == std::numeric_limits<double>::infinity()) {
+        if (!workspace.Reached(dest)) {
             return NoPathExists;
         }
     
         //back tracks from the destination for shortest path
-        for (std::optional<TVertexID> at = dest; at.has_value(); at = previous[*at]) {
-            if (!previous[*at].has_value() && *at != src) {
-                path.clear();
-                return NoPathExists;
-            }
-            path.push_back(*at);
+        for (TVertexID at = dest; at != InvalidVertexID; at = workspace.Parent(at)) {
+            path.push_back(at);
         }
         
         //reverse to get right order (staar to finish)
         std::reverse(path.begin(), path.end());
     
-        return distances[dest];
+        return workspace.Cost(dest);
     }
     
 };
@@ -177,6 +835,36 @@ bool CDijkstraPathRouter::Precompute(std::chrono::steady_clock::time_point deadl
     return DImplementation->Precompute(deadline);
 }
 
+thread_local std::size_t CDijkstraPathRouter::SImplementation::querySettledCount = 0;
+
+// Writes the edges and any precomputed hierarchy to writer, the vertex tags
+// are not written
+bool CDijkstraPathRouter::WriteSnapshot(CSnapshotWriter &writer) noexcept{
+    return DImplementation->WriteSnapshot(writer);
+}
+
+// Replaces the edges with those read from reader, the router must already
+// have the same number of vertices the snapshot was written with
+bool CDijkstraPathRouter::ReadSnapshot(CSnapshotReader &reader) noexcept{
+    return DImplementation->ReadSnapshot(reader);
+}
+
+// Selects the search FindShortestPath runs, ContractionHierarchy falls back
+// to Dijkstra until Precompute has built a hierarchy for the current graph
+void CDijkstraPathRouter::SetSearchMode(ESearchMode mode) noexcept{
+    DImplementation->searchMode = mode;
+}
+
+// Returns the search FindShortestPath runs
+CDijkstraPathRouter::ESearchMode CDijkstraPathRouter::SearchMode() const noexcept{
+    return DImplementation->searchMode;
+}
+
+// Returns the number of vertices settled by the last FindShortestPath
+std::size_t CDijkstraPathRouter::SettledVertexCount() const noexcept{
+    return DImplementation->settledCount;
+}
+
 // Returns the path distance of the path from src to dest, and fills out path
 // with vertices. If no path exists NoPathExists is returned.
 double CDijkstraPathRouter::FindShortestPath(TVertexID src, TVertexID dest, std::vector<TVertexID>
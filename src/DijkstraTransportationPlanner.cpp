@@ -1,266 +1,1676 @@
 #include <memory>
 #include <vector>
 #include <string>
-#include <queue>
 #include <unordered_map>
 #include <limits>
+#include <cmath>
 #include <iostream>
 #include "DijkstraTransportationPlanner.h"
 #include "TransportationPlanner.h"
 #include "StreetMap.h" 
 #include "GeographicUtils.h"
 #include "BusSystem.h"
+#include "DijkstraPathRouter.h"
+#include "SearchWorkspace.h"
+#include "SnapshotReader.h"
+#include "SnapshotWriter.h"
+#include "TransportationPlannerConfig.h"
 #include <algorithm>
+#include <chrono>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <exception>
+#include <iomanip>
+#include <sstream>
+
+// street map element rebuilt from a snapshot, holds the attributes shared
+// by nodes and ways
+template <typename TElement>
+struct SSnapshotElement : public TElement{
+    std::vector<std::pair<std::string, std::string>> DAttributes; // key and value of each attribute
+
+    std::size_t AttributeCount() const noexcept override {
+        return DAttributes.size();
+    }
+
+    std::string GetAttributeKey(std::size_t index) const noexcept override {
+        return index < DAttributes.size() ? DAttributes[index].first : std::string();
+    }
+
+    bool HasAttribute(const std::string &key) const noexcept override {
+        for (const auto &attribute : DAttributes) {
+            if (attribute.first == key) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    std::string GetAttribute(const std::string &key) const noexcept override {
+        for (const auto &attribute : DAttributes) {
+            if (attribute.first == key) {
+                return attribute.second;
+            }
+        }
+        return std::string();
+    }
+};
+
+struct SSnapshotNode : public SSnapshotElement<CStreetMap::SNode>{
+    CStreetMap::TNodeID DID;
+    CStreetMap::TLocation DLocation;
+
+    CStreetMap::TNodeID ID() const noexcept override {
+        return DID;
+    }
+
+    CStreetMap::TLocation Location() const noexcept override {
+        return DLocation;
+    }
+};
+
+struct SSnapshotWay : public SSnapshotElement<CStreetMap::SWay>{
+    CStreetMap::TWayID DID;
+    std::vector<CStreetMap::TNodeID> DNodeIDs;
+
+    CStreetMap::TWayID ID() const noexcept override {
+        return DID;
+    }
+
+    std::size_t NodeCount() const noexcept override {
+        return DNodeIDs.size();
+    }
+
+    CStreetMap::TNodeID GetNodeID(std::size_t index) const noexcept override {
+        return index < DNodeIDs.size() ? DNodeIDs[index] : CStreetMap::InvalidNodeID;
+    }
+};
+
+// street map rebuilt from a snapshot, indexed like COpenStreetMap
+class CSnapshotStreetMap : public CStreetMap{
+    public:
+        std::vector<std::shared_ptr<SSnapshotNode>> DNodes;
+        std::vector<std::shared_ptr<SSnapshotWay>> DWays;
+        std::unordered_map<TNodeID, std::size_t> DNodeIndices;
+        std::unordered_map<TWayID, std::size_t> DWayIndices;
+
+        std::size_t NodeCount() const noexcept override {
+            return DNodes.size();
+        }
+
+        std::size_t WayCount() const noexcept override {
+            return DWays.size();
+        }
+
+        std::shared_ptr<SNode> NodeByIndex(std::size_t index) const noexcept override {
+            return index < DNodes.size() ? DNodes[index] : nullptr;
+        }
+
+        std::shared_ptr<SNode> NodeByID(TNodeID id) const noexcept override {
+            auto search = DNodeIndices.find(id);
+            return search != DNodeIndices.end() ? DNodes[search->second] : nullptr;
+        }
+
+        std::shared_ptr<SWay> WayByIndex(std::size_t index) const noexcept override {
+            return index < DWays.size() ? DWays[index] : nullptr;
+        }
+
+        std::shared_ptr<SWay> WayByID(TWayID id) const noexcept override {
+            auto search = DWayIndices.find(id);
+            return search != DWayIndices.end() ? DWays[search->second] : nullptr;
+        }
+};
+
+struct SSnapshotStop : public CBusSystem::SStop{
+    CBusSystem::TStopID DID;
+    CStreetMap::TNodeID DNodeID;
+
+    CBusSystem::TStopID ID() const noexcept override {
+        return DID;
+    }
+
+    CStreetMap::TNodeID NodeID() const noexcept override {
+        return DNodeID;
+    }
+};
+
+struct SSnapshotRoute : public CBusSystem::SRoute{
+    std::string DName;
+    std::vector<CBusSystem::TStopID> DStopIDs;
+
+    std::string Name() const noexcept override {
+        return DName;
+    }
+
+    std::size_t StopCount() const noexcept override {
+        return DStopIDs.size();
+    }
+
+    CBusSystem::TStopID GetStopID(std::size_t index) const noexcept override {
+        return index < DStopIDs.size() ? DStopIDs[index] : CBusSystem::InvalidStopID;
+    }
+};
+
+// bus system rebuilt from a snapshot, indexed like CCSVBusSystem
+class CSnapshotBusSystem : public CBusSystem{
+    public:
+        std::vector<std::shared_ptr<SSnapshotStop>> DStops;
+        std::vector<std::shared_ptr<SSnapshotRoute>> DRoutes;
+        std::unordered_map<TStopID, std::size_t> DStopIndices;
+        std::unordered_map<std::string, std::size_t> DRouteIndices;
+
+        std::size_t StopCount() const noexcept override {
+            return DStops.size();
+        }
+
+        std::size_t RouteCount() const noexcept override {
+            return DRoutes.size();
+        }
+
+        std::shared_ptr<SStop> StopByIndex(std::size_t index) const noexcept override {
+            return index < DStops.size() ? DStops[index] : nullptr;
+        }
+
+        std::shared_ptr<SStop> StopByID(TStopID id) const noexcept override {
+            auto search = DStopIndices.find(id);
+            return search != DStopIndices.end() ? DStops[search->second] : nullptr;
+        }
+
+        std::shared_ptr<SRoute> RouteByIndex(std::size_t index) const noexcept override {
+            return index < DRoutes.size() ? DRoutes[index] : nullptr;
+        }
+
+        std::shared_ptr<SRoute> RouteByName(const std::string &name) const noexcept override {
+            auto search = DRouteIndices.find(name);
+            return search != DRouteIndices.end() ? DRoutes[search->second] : nullptr;
+        }
+};
 
 struct CDijkstraTransportationPlanner::SImplementation{
+    // bumped whenever the snapshot layout changes, older snapshots are rejected
+    static constexpr uint32_t SnapshotVersion = 3;
+
+    // directed street segment between two dense vertices
+    struct SEdge{
+        std::size_t DDest; // dense index of the destination vertex
+        double DDistance; // haversine length of the segment in miles
+        double DSpeed; // speed limit of the way the segment belongs to
+    };
+
+    // edge of the transit graph. Its vertices are a walk layer and a bike
+    // layer with one vertex per street vertex each, followed by one route
+    // vertex per stop a route leaves from, standing for a rider on that bus
+    // as it departs the stop.
+    struct STransitEdge{
+        std::size_t DDest; // walk, bike or route vertex the edge leads to
+        double DTime; // time in hours
+    };
+
     std::shared_ptr<SConfiguration> DConfig; // configuration object
+    std::vector<TNodeID> DNodeIDs; // node IDs in increasing order, index is the dense vertex ID
+    std::vector<std::size_t> DMapIndices; // street map index of each dense vertex
+    std::unordered_map<TNodeID, std::size_t> DNodeIndices; // node ID to dense vertex ID
+    std::vector<std::vector<SEdge>> DAdjacency; // outgoing segments of each dense vertex
+    std::vector<CStreetMap::TLocation> DLocations; // location of each dense vertex
+    double DMaxSpeed; // fastest speed of any edge in any layer, bounds the A* time heuristic
+    CDijkstraPathRouter DShortestRouter; // distance weighted street graph
+    bool DHierarchyBuilt = false; // Precompute finished the contraction hierarchy of DShortestRouter
+    std::shared_ptr<CBusSystem> DBusSystem; // bus system from the configuration
+    std::vector<uint64_t> DRouteStops; // street vertex of the stop each route vertex departs from
+    std::vector<uint64_t> DTransitRows; // where the transit edges of each layer and route vertex start, plus the end
+    std::vector<STransitEdge> DTransitEdges; // walking, biking, boarding, riding and alighting edges
+    std::atomic<ESearchStrategy> DStrategy = ESearchStrategy::Dijkstra; // search used by the queries, read once per query
+    std::atomic<std::size_t> DSettledCount = 0; // vertices the last street or transit graph search settled
+
+    // how a RAPTOR label was reached
+    enum class ERaptorStep {Access, Copy, Ride, Footpath};
+
+    struct SRaptorParent{
+        ERaptorStep DStep; // Copy takes the label of the previous round
+        std::size_t DFrom; // boarding position of a ride, or stop a footpath starts at
+        std::size_t DTo; // position the ride alights at
+    };
+
+    // labels of one RAPTOR query, reused by every query on a thread
+    struct SRaptorWorkspace{
+        std::vector<double> DArrivals; // arrival at each stop after each round, round after round
+        std::vector<SRaptorParent> DParents; // how each of those arrivals was reached
+        std::vector<double> DBest; // earliest arrival at each stop over all rounds
+        std::vector<std::size_t> DMarked; // stops improved in the last round
+        std::vector<bool> DIsMarked;
+        std::vector<std::size_t> DRouteStarts; // earliest position to scan each route from, InvalidVertexID if it is not queued
+        std::vector<std::size_t> DQueuedRoutes;
+    };
+
+    // rides a RAPTOR journey may take, bounds its transfers
+    static constexpr std::size_t MaxRaptorRounds = 8;
+    // longest walk between two stops RAPTOR transfers over, in hours
+    static constexpr double MaxTransferTime = 20.0 / 60.0;
+    // walking in hours a journey must save over one arriving no later to be
+    // kept as an option, smaller savings would flood riders with near copies
+    static constexpr double OptionWalkSlack = 1.0 / 60.0;
+
+    // street map way of each street segment, keyed by its two vertices in
+    // either order, built the first time a path is described
+    mutable std::once_flag DSegmentWaysBuilt;
+    mutable std::unordered_map<uint64_t, std::size_t> DSegmentWays;
+
+    // RAPTOR tables, built from the transit graph the first time the strategy
+    // is selected or options are requested. A route here is a chain of route
+    // vertices joined by stay-on edges followed by the stop its last ride
+    // alights at.
+    std::once_flag DRaptorBuilt;
+    std::vector<std::size_t> DRaptorStops; // street vertex of each stop
+    std::vector<std::size_t> DRaptorRouteRows; // first position of each route, plus the end
+    std::vector<std::size_t> DRaptorRouteStops; // stop at each position
+    std::vector<double> DRaptorRideTimes; // ride time from each position to the next, 0 at the last
+    std::vector<std::size_t> DRaptorVisitRows; // first visit of each stop, plus the end
+    std::vector<std::pair<std::size_t, std::size_t>> DRaptorVisits; // route and position of each visit to a stop
+    std::vector<std::size_t> DRaptorFootpathRows; // first footpath of each stop, plus the end
+    std::vector<std::pair<std::size_t, double>> DRaptorFootpaths; // stop a footpath leads to and its time
+
+    // journey to a stop found by the multi-criteria search
+    struct SOptionLabel{
+        double DArrival; // time since leaving src
+        double DWalk; // time of it spent walking
+        std::size_t DStop;
+        std::size_t DRound; // rides taken
+        ERaptorStep DStep; // Access, Ride or Footpath
+        std::size_t DParent; // label the journey continues
+        std::size_t DFrom; // boarding position of a ride
+        std::size_t DTo; // position the ride alights at
+        bool DActive; // cleared once a label of the same round dominates it
+    };
+
+    // rider on the bus while a route is scanned
+    struct SOptionTrip{
+        double DArrival; // time the bus is at the scanned position
+        double DWalk;
+        std::size_t DLabel; // label the rider boarded from
+        std::size_t DBoarded; // position the rider boarded at
+    };
+
+    // journey that walks on to dest from a label. Round 0 journeys walk or
+    // bike all the way and hold the dest vertex of their layer instead.
+    struct SOptionTarget{
+        double DArrival;
+        double DWalk;
+        std::size_t DRound;
+        std::size_t DLabel;
+        bool DActive;
+    };
 
-    // constructor
+    // labels of one multi-criteria query, reused by every query on a thread.
+    // Labels live in one array, the bags only hold their indices.
+    struct SOptionWorkspace{
+        std::vector<SOptionLabel> DLabels;
+        std::vector<SOptionTarget> DTargets;
+        std::vector<std::vector<std::size_t>> DBags; // labels of each stop no other label dominates
+        std::vector<std::vector<std::size_t>> DPrevious; // labels each stop gained in the last round
+        std::vector<std::vector<std::size_t>> DCurrent; // labels each stop gained in this round
+        std::vector<std::size_t> DPreviousMarked; // stops with labels in DPrevious
+        std::vector<std::size_t> DMarked; // stops with labels in DCurrent
+        std::vector<std::size_t> DTouched; // stops with labels in their bag
+        std::vector<std::size_t> DRouteStarts;
+        std::vector<std::size_t> DQueuedRoutes;
+        std::vector<SOptionTrip> DTrips;
+    };
+
+    // snapshots are read into an empty planner
+    SImplementation() : DMaxSpeed(0.0) {
+    }
+
+    // constructor builds the street graph once so queries only touch settled vertices
     SImplementation(std::shared_ptr<SConfiguration> config) 
-        : DConfig(config) {
+        : DConfig(config), DMaxSpeed(config->DefaultSpeedLimit()) {
+        auto StartTime = std::chrono::steady_clock::now();
+        auto streetMap = DConfig->StreetMap();
+        if (!streetMap) {
+            return;
+        }
+        std::vector<std::pair<TNodeID, std::size_t>> order; // ID and street map index of each node
+        for (size_t i = 0; i < streetMap->NodeCount(); ++i) { // gather all of the nodes
+            auto node = streetMap->NodeByIndex(i);
+            if (node) {
+                order.emplace_back(node->ID(), i);
+            }
+        }
+        std::sort(order.begin(), order.end()); // sort nodes by increasing ID
+        DNodeIndices.reserve(order.size());
+        for (size_t i = 0; i < order.size(); ++i) { // assign dense vertex IDs in sorted order
+            DNodeIndices[order[i].first] = i;
+            DNodeIDs.push_back(order[i].first);
+            DMapIndices.push_back(order[i].second);
+            DLocations.push_back(streetMap->NodeByIndex(order[i].second)->Location());
+            DShortestRouter.AddVertex(order[i].first);
+        }
+        DAdjacency.resize(DNodeIDs.size());
+
+        const std::size_t streetCount = DNodeIDs.size();
+        const double walkSpeed = DConfig->WalkSpeed(), bikeSpeed = DConfig->BikeSpeed();
+        std::vector<std::vector<STransitEdge>> layers(2 * streetCount); // walk and bike layers of the transit graph
+        DMaxSpeed = std::max({DMaxSpeed, walkSpeed, bikeSpeed});
+        for (size_t i = 0; i < streetMap->WayCount(); ++i) { // iterate through the ways in the street map
+            auto way = streetMap->WayByIndex(i);
+            if (!way || way->NodeCount() < 2) {
+                continue;
+            }
+            double speed = ParseSpeed(way); // speed is per way, compute it once
+            DMaxSpeed = std::max(DMaxSpeed, speed);
+            auto directions = ParseOneway(way);
+            for (size_t j = 0; j + 1 < way->NodeCount(); ++j) { // iterate through the segments of the way
+                auto u = DNodeIndices.find(way->GetNodeID(j));
+                auto v = DNodeIndices.find(way->GetNodeID(j + 1));
+                if (u == DNodeIndices.end() || v == DNodeIndices.end()) { // skip segments referencing missing nodes
+                    continue;
+                }
+                double distance = SGeographicUtils::HaversineDistanceInMiles(
+                    DLocations[u->second], DLocations[v->second]
+                );
+                DAdjacency[u->second].push_back({v->second, distance, speed});
+                DShortestRouter.AddEdge(u->second, v->second, distance);
+                // pedestrians walk both ways, cyclists keep to oneway streets
+                layers[u->second].push_back({v->second, distance / walkSpeed});
+                layers[v->second].push_back({u->second, distance / walkSpeed});
+                if (directions.first) {
+                    layers[streetCount + u->second].push_back({streetCount + v->second, distance / bikeSpeed});
+                }
+                if (directions.second) {
+                    layers[streetCount + v->second].push_back({streetCount + u->second, distance / bikeSpeed});
+                }
+            }
+        }
+        BuildTransitGraph(std::move(layers));
+        DHierarchyBuilt = DShortestRouter.Precompute(StartTime + std::chrono::seconds(DConfig->PrecomputeTime()));
     }
 
-    // destructor
-    ~SImplementation(){
+    // writes the attributes of each element as a row of key and value strings
+    template <typename TElement>
+    static bool WriteAttributes(CSnapshotWriter &writer, const std::vector<std::shared_ptr<TElement>> &elements) {
+        std::vector<uint64_t> rows = {0};
+        for (const auto &element : elements) {
+            rows.push_back(rows.back() + element->AttributeCount());
+        }
+        if (!writer.WriteArray(rows)) {
+            return false;
+        }
+        for (const auto &element : elements) {
+            for (std::size_t index = 0; index < element->AttributeCount(); ++index) {
+                auto key = element->GetAttributeKey(index);
+                if (!writer.WriteString(key) || !writer.WriteString(element->GetAttribute(key))) {
+                    return false;
+                }
+            }
+        }
+        return true;
     }
 
-    // returns the number of nodes in the street map
-    std::size_t NodeCount() const noexcept {
-        return DConfig->StreetMap()->NodeCount();
+    // true if rows splits size entries into count rows, starting at 0 and
+    // never going back
+    static bool ValidRows(const std::vector<uint64_t> &rows, std::size_t count, std::size_t size) {
+        if (rows.size() != count + 1 || rows.front() != 0 || rows.back() != size) {
+            return false;
+        }
+        for (std::size_t index = 0; index < count; ++index) {
+            if (rows[index + 1] < rows[index]) {
+                return false;
+            }
+        }
+        return true;
     }
-    
-    // returns the street map node specified by index
-    std::shared_ptr<CStreetMap::SNode> SortedNodeByIndex(std::size_t index) const noexcept {
-        auto streetMap = DConfig->StreetMap(); // get the street map from the configuration
-        if (!streetMap || index >= streetMap->NodeCount()) { // check if the street map is valid and the index is within bounds
-            return nullptr; // return nullptr if the street map is invalid or the index is out of bounds
+
+    // every attribute is written as two strings, each at least its length
+    static constexpr std::size_t MinAttributeSize = 2 * sizeof(uint64_t);
+
+    template <typename TElement>
+    static bool ReadAttributes(CSnapshotReader &reader, std::vector<std::shared_ptr<TElement>> &elements) {
+        std::vector<uint64_t> rows;
+        if (!reader.ReadArray(rows) || rows.empty() || rows.back() > reader.Remaining() / MinAttributeSize ||
+            !ValidRows(rows, elements.size(), rows.back())) {
+            return false;
         }
-    
-        std::vector<std::shared_ptr<CStreetMap::SNode>> Nodes; // create a vector of nodes
-        for (size_t i = 0; i < streetMap->NodeCount(); i++) { // iterate through the nodes in the street map
-            Nodes.push_back(streetMap->NodeByIndex(i)); // add the node to the vector
+        for (std::size_t index = 0; index < elements.size(); ++index) {
+            elements[index]->DAttributes.resize(rows[index + 1] - rows[index]);
+            for (auto &attribute : elements[index]->DAttributes) {
+                if (!reader.ReadString(attribute.first) || !reader.ReadString(attribute.second)) {
+                    return false;
+                }
+            }
         }
-    
-        std::sort(Nodes.begin(), Nodes.end(), [](const auto &a, const auto &b) {
-            return a->ID() < b->ID(); // sort nodes by increasing ID
-        });
-    
-        return Nodes[index]; // return the sorted node at the requested index        
+        return true;
     }
-    
-    double FindShortestPath(TNodeID src, TNodeID dest, std::vector<TNodeID> &path) {
-        auto streetMap = DConfig->StreetMap(); // get the street map from the configuration
-        if (!streetMap || streetMap->NodeCount() == 0) { // check if the street map is valid and not empty
-            return CPathRouter::NoPathExists; // return NoPathExists if the street map is invalid or empty
+
+    // writes the configuration, street map, bus system and the built graph
+    bool WriteSnapshot(std::shared_ptr<CDataSink> sink) {
+        auto streetMap = DConfig ? DConfig->StreetMap() : nullptr;
+        if (!sink || !streetMap) {
+            return false;
         }
-        
-        std::unordered_map<TNodeID, double> distances; // create a map to store distances
-        std::unordered_map<TNodeID, TNodeID> parents; // create a map to store parent nodes
-        std::priority_queue<std::pair<double, TNodeID>, std::vector<std::pair<double, TNodeID>>, std::greater<>> pq; // create a priority queue
+        CSnapshotWriter writer(sink, SnapshotVersion);
+        bool ok = writer.WriteValue(DConfig->WalkSpeed()) && writer.WriteValue(DConfig->BikeSpeed()) &&
+                  writer.WriteValue(DConfig->DefaultSpeedLimit()) && writer.WriteValue(DConfig->BusStopTime()) &&
+                  writer.WriteValue(int32_t(DConfig->PrecomputeTime()));
 
-        // initialize structures
+        // nodes in street map order, the planner order is written as indices into them
+        std::vector<std::shared_ptr<CStreetMap::SNode>> nodes;
+        std::vector<uint64_t> nodeIndices(streetMap->NodeCount()); // position of each street map node in nodes
+        std::vector<uint64_t> nodeIDs, sortedOrder;
+        std::vector<double> latitudes, longitudes;
         for (size_t i = 0; i < streetMap->NodeCount(); ++i) {
-            TNodeID nodeID = streetMap->NodeByIndex(i)->ID(); // get the node ID
+            auto node = streetMap->NodeByIndex(i);
+            if (node) {
+                nodeIndices[i] = nodes.size();
+                nodes.push_back(node);
+                nodeIDs.push_back(node->ID());
+                latitudes.push_back(node->Location().first);
+                longitudes.push_back(node->Location().second);
+            }
+        }
+        for (auto index : DMapIndices) {
+            sortedOrder.push_back(nodeIndices[index]);
+        }
+        ok = ok && writer.WriteArray(nodeIDs) && writer.WriteArray(latitudes) && writer.WriteArray(longitudes) &&
+             WriteAttributes(writer, nodes) && writer.WriteArray(sortedOrder);
+
+        std::vector<std::shared_ptr<CStreetMap::SWay>> ways;
+        std::vector<uint64_t> wayIDs, wayRows = {0}, wayNodeIDs;
+        for (size_t i = 0; i < streetMap->WayCount(); ++i) {
+            auto way = streetMap->WayByIndex(i);
+            if (way) {
+                ways.push_back(way);
+                wayIDs.push_back(way->ID());
+                for (size_t j = 0; j < way->NodeCount(); ++j) {
+                    wayNodeIDs.push_back(way->GetNodeID(j));
+                }
+                wayRows.push_back(wayNodeIDs.size());
+            }
+        }
+        ok = ok && writer.WriteArray(wayIDs) && writer.WriteArray(wayRows) && writer.WriteArray(wayNodeIDs) &&
+             WriteAttributes(writer, ways);
+
+        // bus system tables, an empty bus system is written for a planner without one
+        std::vector<uint64_t> stopIDs, stopNodeIDs, routeRows = {0}, routeStopIDs;
+        std::vector<std::string> routeNames;
+        for (size_t i = 0; DBusSystem && i < DBusSystem->StopCount(); ++i) {
+            auto stop = DBusSystem->StopByIndex(i);
+            if (stop) {
+                stopIDs.push_back(stop->ID());
+                stopNodeIDs.push_back(stop->NodeID());
+            }
+        }
+        for (size_t i = 0; DBusSystem && i < DBusSystem->RouteCount(); ++i) {
+            auto route = DBusSystem->RouteByIndex(i);
+            if (route) {
+                routeNames.push_back(route->Name());
+                for (size_t j = 0; j < route->StopCount(); ++j) {
+                    routeStopIDs.push_back(route->GetStopID(j));
+                }
+                routeRows.push_back(routeStopIDs.size());
+            }
+        }
+        ok = ok && writer.WriteValue(uint8_t(DBusSystem != nullptr)) && writer.WriteArray(stopIDs) && writer.WriteArray(stopNodeIDs) &&
+             writer.WriteArray(routeRows) && writer.WriteArray(routeStopIDs);
+        for (const auto &name : routeNames) {
+            ok = ok && writer.WriteString(name);
+        }
+
+        // built graph, the adjacency lists are written in CSR form
+        std::vector<uint64_t> adjacencyRows = {0};
+        std::vector<SEdge> edges;
+        for (const auto &adjacent : DAdjacency) {
+            edges.insert(edges.end(), adjacent.begin(), adjacent.end());
+            adjacencyRows.push_back(edges.size());
+        }
+        ok = ok && writer.WriteValue(DMaxSpeed) && writer.WriteArray(adjacencyRows) && writer.WriteArray(edges) &&
+             writer.WriteArray(DRouteStops) && writer.WriteArray(DTransitRows) && writer.WriteArray(DTransitEdges) &&
+             DShortestRouter.WriteSnapshot(writer) && writer.WriteValue(CSnapshotWriter::Magic);
+        return writer.Flush() && ok;
+    }
+
+    // rebuilds the planner from a snapshot, returns false if it is truncated,
+    // inconsistent or from another version
+    bool ReadSnapshot(CSnapshotReader &reader) {
+        double walkSpeed, bikeSpeed, speedLimit, busStopTime;
+        int32_t precomputeTime;
+        if (!reader.Valid() || reader.Version() != SnapshotVersion ||
+            !reader.ReadValue(walkSpeed) || !reader.ReadValue(bikeSpeed) || !reader.ReadValue(speedLimit) ||
+            !reader.ReadValue(busStopTime) || !reader.ReadValue(precomputeTime) ||
+            !(walkSpeed > 0) || !(bikeSpeed > 0) || !(speedLimit > 0) || !(busStopTime >= 0)) {
+            return false;
+        }
 
-            // initialize the nodes to inifinity
-            distances[nodeID] = std::numeric_limits<double>::max();
+        auto streetMap = std::make_shared<CSnapshotStreetMap>();
+        std::vector<uint64_t> nodeIDs, sortedOrder;
+        std::vector<double> latitudes, longitudes;
+        if (!reader.ReadArray(nodeIDs) || !reader.ReadArray(latitudes) || !reader.ReadArray(longitudes) ||
+            latitudes.size() != nodeIDs.size() || longitudes.size() != nodeIDs.size()) {
+            return false;
+        }
+        for (std::size_t index = 0; index < nodeIDs.size(); ++index) {
+            if (!std::isfinite(latitudes[index]) || !std::isfinite(longitudes[index])) {
+                return false;
+            }
+        }
+        streetMap->DNodes.reserve(nodeIDs.size());
+        streetMap->DNodeIndices.reserve(nodeIDs.size());
+        for (std::size_t index = 0; index < nodeIDs.size(); ++index) {
+            auto node = std::make_shared<SSnapshotNode>();
+            node->DID = nodeIDs[index];
+            node->DLocation = {latitudes[index], longitudes[index]};
+            streetMap->DNodeIndices.emplace(node->DID, index);
+            streetMap->DNodes.push_back(std::move(node));
+        }
+        if (!ReadAttributes(reader, streetMap->DNodes) || !reader.ReadArray(sortedOrder) || sortedOrder.size() > nodeIDs.size()) {
+            return false;
+        }
+
+        std::vector<uint64_t> wayIDs, wayRows, wayNodeIDs;
+        if (!reader.ReadArray(wayIDs) || !reader.ReadArray(wayRows) || !reader.ReadArray(wayNodeIDs) ||
+            !ValidRows(wayRows, wayIDs.size(), wayNodeIDs.size())) {
+            return false;
+        }
+        for (std::size_t index = 0; index < wayIDs.size(); ++index) {
+            auto way = std::make_shared<SSnapshotWay>();
+            way->DID = wayIDs[index];
+            way->DNodeIDs.assign(wayNodeIDs.begin() + wayRows[index], wayNodeIDs.begin() + wayRows[index + 1]);
+            streetMap->DWayIndices.emplace(way->DID, index);
+            streetMap->DWays.push_back(std::move(way));
+        }
+        if (!ReadAttributes(reader, streetMap->DWays)) {
+            return false;
+        }
+
+        uint8_t hasBusSystem;
+        auto busSystem = std::make_shared<CSnapshotBusSystem>();
+        std::vector<uint64_t> stopIDs, stopNodeIDs, routeRows, routeStopIDs;
+        if (!reader.ReadValue(hasBusSystem) || !reader.ReadArray(stopIDs) || !reader.ReadArray(stopNodeIDs) ||
+            !reader.ReadArray(routeRows) || !reader.ReadArray(routeStopIDs) || stopNodeIDs.size() != stopIDs.size() ||
+            routeRows.empty() || !ValidRows(routeRows, routeRows.size() - 1, routeStopIDs.size())) {
+            return false;
+        }
+        for (std::size_t index = 0; index < stopIDs.size(); ++index) {
+            auto stop = std::make_shared<SSnapshotStop>();
+            stop->DID = stopIDs[index];
+            stop->DNodeID = stopNodeIDs[index];
+            busSystem->DStopIndices.emplace(stop->DID, index);
+            busSystem->DStops.push_back(std::move(stop));
+        }
+        for (std::size_t index = 0; index + 1 < routeRows.size(); ++index) {
+            auto route = std::make_shared<SSnapshotRoute>();
+            if (!reader.ReadString(route->DName)) {
+                return false;
+            }
+            route->DStopIDs.assign(routeStopIDs.begin() + routeRows[index], routeStopIDs.begin() + routeRows[index + 1]);
+            busSystem->DRouteIndices.emplace(route->DName, index);
+            busSystem->DRoutes.push_back(std::move(route));
+        }
+
+        DConfig = std::make_shared<STransportationPlannerConfig>(streetMap, hasBusSystem ? busSystem : nullptr,
+                                                                 walkSpeed, bikeSpeed, speedLimit, busStopTime, precomputeTime);
+        DBusSystem = DConfig->BusSystem();
+        for (auto index : sortedOrder) {
+            if (index >= streetMap->DNodes.size()) {
+                return false;
+            }
+            DNodeIDs.push_back(streetMap->DNodes[index]->ID());
+            DMapIndices.push_back(index);
+        }
+        DNodeIndices.reserve(DNodeIDs.size());
+        for (size_t i = 0; i < DNodeIDs.size(); ++i) { // assign dense vertex IDs in sorted order
+            DNodeIndices[DNodeIDs[i]] = i;
+            DLocations.push_back(streetMap->DNodes[DMapIndices[i]]->Location());
+            DShortestRouter.AddVertex(DNodeIDs[i]);
         }
 
-        // initialize starting point distance
-        distances[src] = 0;
-        pq.push({0, src}); // push the starting point to the priority queue
+        std::vector<uint64_t> adjacencyRows;
+        std::vector<SEdge> edges;
+        uint32_t endMarker;
+        if (!reader.ReadValue(DMaxSpeed) || !reader.ReadArray(adjacencyRows) || !reader.ReadArray(edges) ||
+            !reader.ReadArray(DRouteStops) || !reader.ReadArray(DTransitRows) || !reader.ReadArray(DTransitEdges) ||
+            !(DMaxSpeed > 0) || !ValidRows(adjacencyRows, DNodeIDs.size(), edges.size())) {
+            return false;
+        }
+        // searches assume no edge takes negative time or distance
+        for (const auto &edge : edges) {
+            if (edge.DDest >= DNodeIDs.size() || !(edge.DDistance >= 0) || !(edge.DSpeed > 0)) {
+                return false;
+            }
+        }
+        // a planner without a bus system only has the walk and bike layers
+        if ((!DBusSystem && !DRouteStops.empty()) || !ValidRows(DTransitRows, RouteVertex(DRouteStops.size()), DTransitEdges.size())) {
+            return false;
+        }
+        for (auto stop : DRouteStops) {
+            if (stop >= DNodeIDs.size()) {
+                return false;
+            }
+        }
+        if (!ValidTransitEdges()) {
+            return false;
+        }
+        DAdjacency.resize(DNodeIDs.size());
+        for (std::size_t index = 0; index < DNodeIDs.size(); ++index) {
+            DAdjacency[index].assign(edges.begin() + adjacencyRows[index], edges.begin() + adjacencyRows[index + 1]);
+        }
+        if (!DShortestRouter.ReadSnapshot(reader) || !reader.ReadValue(endMarker) || endMarker != CSnapshotWriter::Magic) {
+            return false;
+        }
+        // a deadline that has passed builds nothing, it only reports whether
+        // the snapshot holds a finished hierarchy
+        DHierarchyBuilt = DShortestRouter.Precompute(std::chrono::steady_clock::time_point::min());
+        return true;
+    }
 
-        // calculate distances to all nodes
-        while (!pq.empty()) {
-            // extract node with shortest distance
-            auto [cost, node] = pq.top();
-            pq.pop(); // remove the node from the priority queue
+    // true if the transit edges keep to the layers BuildTransitGraph lays
+    // out: walkers walk or board, cyclists stay on their bikes, and every
+    // route vertex alights at exactly one stop
+    bool ValidTransitEdges() const {
+        for (std::size_t vertex = 0; vertex + 1 < DTransitRows.size(); ++vertex) {
+            std::size_t alights = 0;
+            for (auto index = DTransitRows[vertex]; index < DTransitRows[vertex + 1]; ++index) {
+                const auto &edge = DTransitEdges[index];
+                bool walks = edge.DDest < BikeVertex(0), bikes = !walks && edge.DDest < RouteVertex(0);
+                if (!(edge.DTime >= 0) || edge.DDest >= DTransitRows.size() - 1 || bikes != (vertex >= BikeVertex(0) && vertex < RouteVertex(0))) {
+                    return false;
+                }
+                alights += vertex >= RouteVertex(0) && walks;
+            }
+            if (vertex >= RouteVertex(0) && alights != 1) {
+                return false;
+            }
+        }
+        return true;
+    }
 
-            if (node == dest) {
-                break; // break if the destination node is reached
+    // fastest time in hours to drive from the street vertex src to dest, or
+    // the straight line time at the default speed limit if dest cannot be
+    // reached over the streets
+    double RideTime(std::size_t src, std::size_t dest, SSearchWorkspace<std::size_t> &workspace) const {
+        workspace.Reset(DNodeIDs.size());
+        workspace.Set(src, 0, src);
+        workspace.Push(0, 0, src);
+        while (!workspace.Empty()) {
+            auto entry = workspace.Pop();
+            if (entry.DVertex == dest) {
+                return entry.DCost;
             }
-            auto currentNode = streetMap->NodeByID(node); // get the current node
-            if (!currentNode) { // check if the current node is valid
+            if (entry.DCost > workspace.Cost(entry.DVertex)) { // skip stale queue entries
                 continue;
             }
+            for (const auto &edge : DAdjacency[entry.DVertex]) {
+                double time = entry.DCost + edge.DDistance / edge.DSpeed;
+                if (time < workspace.Cost(edge.DDest)) {
+                    workspace.Set(edge.DDest, time, entry.DVertex);
+                    workspace.Push(time, time, edge.DDest);
+                }
+            }
+        }
+        return SGeographicUtils::HaversineDistanceInMiles(DLocations[src], DLocations[dest]) / DConfig->DefaultSpeedLimit();
+    }
 
-            for (size_t i = 0; i < streetMap->WayCount(); ++i) { // iterate through the ways in the street map
-                auto way = streetMap->WayByIndex(i); // get the way
-                if (!way) { // check if the way is valid
+    // compiles the routes into the transit graph after the walk and bike
+    // layers once so queries never touch the shared bus system objects,
+    // copying their shared pointers from several threads would contend on
+    // the reference counts. Boarding and alighting are the only edges between
+    // layers, a bike cannot be taken on the bus and there is deliberately no
+    // edge between a node's walk and bike vertices. A rider boards at a stop's
+    // walk vertex for BusStopTime, every stop the bus then passes through
+    // costs BusStopTime again, and alighting is free.
+    void BuildTransitGraph(std::vector<std::vector<STransitEdge>> adjacency) {
+        DBusSystem = DConfig->BusSystem();
+        const double stopTime = DConfig->BusStopTime() / 3600.0;
+        std::unordered_map<uint64_t, double> rideTimes; // ride time between street vertices, routes often share stops
+        SSearchWorkspace<std::size_t> workspace;
+        for (size_t i = 0; DBusSystem && i < DBusSystem->RouteCount(); ++i) { // iterate through the routes in the bus system
+            auto route = DBusSystem->RouteByIndex(i); // get the route
+            if (!route) { // check if the route is valid
+                continue;
+            }
+            // street vertex of each stop on the route, stops that are not on
+            // the map split the route
+            std::vector<std::size_t> stops;
+            for (size_t j = 0; j < route->StopCount(); ++j) {
+                auto stop = DBusSystem->StopByID(route->GetStopID(j));
+                auto index = stop ? DNodeIndices.find(stop->NodeID()) : DNodeIndices.end();
+                stops.push_back(index != DNodeIndices.end() ? index->second : CPathRouter::InvalidVertexID);
+            }
+            std::size_t previous = CPathRouter::InvalidVertexID; // route vertex at the previous stop
+            double previousRide = 0.0; // ride time from the previous stop to this one
+            for (size_t j = 0; j + 1 < stops.size(); ++j) {
+                if (stops[j] == CPathRouter::InvalidVertexID || stops[j + 1] == CPathRouter::InvalidVertexID) {
+                    previous = CPathRouter::InvalidVertexID;
                     continue;
                 }
+                auto ride = rideTimes.find(uint64_t(stops[j]) * DNodeIDs.size() + stops[j + 1]);
+                if (ride == rideTimes.end()) {
+                    ride = rideTimes.emplace(uint64_t(stops[j]) * DNodeIDs.size() + stops[j + 1], RideTime(stops[j], stops[j + 1], workspace)).first;
+                }
+                std::size_t vertex = adjacency.size(); // route vertex departing this stop
+                DRouteStops.push_back(stops[j]);
+                adjacency.emplace_back();
+                adjacency[stops[j]].push_back({vertex, stopTime}); // board
+                adjacency[vertex].push_back({stops[j + 1], ride->second}); // alight at the next stop
+                if (previous != CPathRouter::InvalidVertexID) {
+                    adjacency[previous].push_back({vertex, previousRide + stopTime}); // stay on through this stop
+                }
+                previous = vertex;
+                previousRide = ride->second;
+            }
+        }
+        DTransitRows = {0};
+        for (const auto &edges : adjacency) {
+            DTransitEdges.insert(DTransitEdges.end(), edges.begin(), edges.end());
+            DTransitRows.push_back(DTransitEdges.size());
+        }
+    }
+
+    // transit graph vertex of a street vertex in the bike layer, the walk
+    // layer uses the street vertices themselves
+    std::size_t BikeVertex(std::size_t vertex) const {
+        return DNodeIDs.size() + vertex;
+    }
+
+    // transit graph vertex of a route vertex
+    std::size_t RouteVertex(std::size_t route) const {
+        return 2 * DNodeIDs.size() + route;
+    }
 
-                for (size_t j = 0; j < way->NodeCount() - 1; ++j) { // iterate through the nodes in the way
-                    TNodeID u = way->GetNodeID(j); // get the start node
-                    TNodeID v = way->GetNodeID(j + 1); // get the end node
-                    double weight = SGeographicUtils::HaversineDistanceInMiles( // calculate the weight of the edge
-                        streetMap->NodeByID(u)->Location(), streetMap->NodeByID(v)->Location()
-                    );
+    // street vertex a walk, bike or route vertex of the transit graph stands at
+    std::size_t StreetVertex(std::size_t vertex) const {
+        return vertex < RouteVertex(0) ? vertex % DNodeIDs.size() : DRouteStops[vertex - RouteVertex(0)];
+    }
+
+    // location of a walk, bike or route vertex of the transit graph
+    const CStreetMap::TLocation &VertexLocation(std::size_t vertex) const {
+        return DLocations[StreetVertex(vertex)];
+    }
 
-                    if (distances[u] + weight < distances[v]) { // check if the new distance is shorter
-                        distances[v] = distances[u] + weight; // update the distance
-                        parents[v] = u; // update the parent node
-                        pq.push({distances[v], v}); // push the node to the priority queue
+    // settles the vertices of the walk or bike layer src is in, in time order
+    // from src until dest is settled or the next vertex is at least limit
+    // away. Walking is symmetric, so a walk from src also gives the walk to
+    // src read backward. Vertices reached but not settled keep the time of a
+    // real path. If reached is given every vertex reached is added to it once.
+    void SearchStreets(SSearchWorkspace<std::size_t> &workspace, std::size_t src, std::size_t dest, double limit, std::vector<std::size_t> *reached = nullptr) const {
+        workspace.Reset(RouteVertex(0));
+        workspace.Set(src, 0, CPathRouter::InvalidVertexID);
+        workspace.Push(0, 0, src);
+        if (reached) {
+            reached->push_back(src);
+        }
+        while (!workspace.Empty()) {
+            auto entry = workspace.Pop();
+            if (entry.DCost > workspace.Cost(entry.DVertex)) { // skip stale queue entries
+                continue;
+            }
+            if (entry.DVertex == dest || entry.DCost >= limit) {
+                break;
+            }
+            for (auto index = DTransitRows[entry.DVertex]; index < DTransitRows[entry.DVertex + 1]; ++index) {
+                const auto &edge = DTransitEdges[index];
+                if (edge.DDest < RouteVertex(0) && entry.DCost + edge.DTime < workspace.Cost(edge.DDest)) { // stay off the buses
+                    if (reached && !workspace.Reached(edge.DDest)) {
+                        reached->push_back(edge.DDest);
                     }
+                    workspace.Set(edge.DDest, entry.DCost + edge.DTime, entry.DVertex);
+                    workspace.Push(entry.DCost + edge.DTime, entry.DCost + edge.DTime, edge.DDest);
                 }
             }
         }
+    }
 
-        if (distances[dest] == std::numeric_limits<double>::max()) // check if the destination node is unreachable
-            return CPathRouter::NoPathExists; // return NoPathExists if the destination node is unreachable
+    // selects the search, the RAPTOR tables are built the first time it is
+    // chosen and before any query can see it
+    void SetSearchStrategy(ESearchStrategy strategy) {
+        if (strategy == ESearchStrategy::Raptor) {
+            std::call_once(DRaptorBuilt, [this]() { BuildRaptorTables(); });
+        }
+        DStrategy = strategy;
+    }
 
-        // Reconstruct the path from source to destination
-        TNodeID current = dest;
-        while (current != src) { // iterate from destination to source
-            path.push_back(current); // add the node to the path
-            current = parents[current]; // move to the parent node
+    // derives the RAPTOR routes from the route vertices of the transit graph
+    // and finds the footpaths between stops
+    void BuildRaptorTables() {
+        const std::size_t routeBase = RouteVertex(0);
+        std::unordered_map<std::size_t, std::size_t> stopIndices; // street vertex to stop
+        auto stopIndex = [&](std::size_t vertex) {
+            auto result = stopIndices.emplace(vertex, DRaptorStops.size());
+            if (result.second) {
+                DRaptorStops.push_back(vertex);
+            }
+            return result.first->second;
+        };
+        // route vertices are numbered along their routes, one that no stay-on
+        // edge leads to starts a route
+        std::vector<bool> continued(DRouteStops.size(), false);
+        for (std::size_t index = DTransitRows[routeBase]; index < DTransitEdges.size(); ++index) {
+            if (DTransitEdges[index].DDest >= routeBase) {
+                continued[DTransitEdges[index].DDest - routeBase] = true;
+            }
         }
-        path.push_back(src); // add the source node to the path
-        std::reverse(path.begin(), path.end()); // reverse the path
+        for (std::size_t route = 0; route < DRouteStops.size(); ++route) {
+            std::size_t alight = CPathRouter::InvalidVertexID;
+            double ride = 0.0;
+            bool stays = false;
+            for (auto index = DTransitRows[routeBase + route]; index < DTransitRows[routeBase + route + 1]; ++index) {
+                if (DTransitEdges[index].DDest < routeBase) {
+                    alight = DTransitEdges[index].DDest;
+                    ride = DTransitEdges[index].DTime;
+                } else {
+                    stays = true;
+                }
+            }
+            if (!continued[route]) {
+                DRaptorRouteRows.push_back(DRaptorRouteStops.size());
+            }
+            DRaptorRouteStops.push_back(stopIndex(DRouteStops[route]));
+            DRaptorRideTimes.push_back(ride);
+            if (!stays) {
+                DRaptorRouteStops.push_back(stopIndex(alight));
+                DRaptorRideTimes.push_back(0.0);
+            }
+        }
+        DRaptorRouteRows.push_back(DRaptorRouteStops.size());
 
-        return distances[dest]; // return the distance to the destination
+        std::vector<std::vector<std::pair<std::size_t, std::size_t>>> visits(DRaptorStops.size());
+        for (std::size_t route = 0; route + 1 < DRaptorRouteRows.size(); ++route) {
+            for (auto position = DRaptorRouteRows[route]; position < DRaptorRouteRows[route + 1]; ++position) {
+                visits[DRaptorRouteStops[position]].push_back({route, position});
+            }
+        }
+        DRaptorVisitRows = {0};
+        for (const auto &stopVisits : visits) {
+            DRaptorVisits.insert(DRaptorVisits.end(), stopVisits.begin(), stopVisits.end());
+            DRaptorVisitRows.push_back(DRaptorVisits.size());
+        }
+
+        // footpaths only go to the stops each bounded walk reaches, in stop order
+        SSearchWorkspace<std::size_t> workspace;
+        std::vector<std::size_t> reached;
+        DRaptorFootpathRows = {0};
+        for (std::size_t stop = 0; stop < DRaptorStops.size(); ++stop) {
+            reached.clear();
+            SearchStreets(workspace, DRaptorStops[stop], CPathRouter::InvalidVertexID, MaxTransferTime, &reached);
+            for (auto vertex : reached) {
+                auto other = stopIndices.find(vertex);
+                double time = workspace.Cost(vertex);
+                if (other != stopIndices.end() && other->second != stop && time <= MaxTransferTime) {
+                    DRaptorFootpaths.push_back({other->second, time});
+                }
+            }
+            std::sort(DRaptorFootpaths.begin() + DRaptorFootpathRows.back(), DRaptorFootpaths.end());
+            DRaptorFootpathRows.push_back(DRaptorFootpaths.size());
+        }
+    }
+
+    // destructor
+    ~SImplementation(){
     }
 
-    std::shared_ptr<CBusSystem::SStop> FindStopByNodeID(TNodeID nodeID, std::shared_ptr<CBusSystem> busSystem) { 
-        for (size_t i = 0; i < busSystem->StopCount(); ++i) { // iterate through the stops in the bus system
-            auto stop = busSystem->StopByIndex(i); // get the stop
-            if (stop && stop->NodeID() == nodeID) {
-                return stop;  // return the bus stop if found
+    // returns the speed limit of a way, or the default if it has no usable maxspeed
+    double ParseSpeed(const std::shared_ptr<CStreetMap::SWay> &way) const {
+        double speed = DConfig->DefaultSpeedLimit(); // get the default speed limit
+        if (way->HasAttribute("maxspeed")) { // check if the way has a maxspeed attribute
+            std::string speed_str = way->GetAttribute("maxspeed"); // get the maxspeed attribute
+            if (speed_str.find("mph") != std::string::npos) { // check if the speed is in mph
+                try {
+                    speed = std::stod(speed_str.substr(0, speed_str.find("mph"))); // convert the speed to double
+                } catch (const std::exception &) {
+                    speed = DConfig->DefaultSpeedLimit(); // malformed maxspeed, keep the default
+                }
             }
         }
-        return nullptr; // no stop found at this node
+        return speed;
     }
 
-    double FindFastestPath(TNodeID src, TNodeID dest, std::vector<TTripStep> &path) {
-        auto streetMap = DConfig->StreetMap(); // get the street map from the configuration
-        auto busSystem = DConfig->BusSystem(); // get the bus system from the configuration
-        if (!streetMap || !busSystem || streetMap->NodeCount() == 0) {
-            return CPathRouter::NoPathExists; // return NoPathExists if the street map or bus system is invalid or empty
+    // returns whether a way may be followed in node order and against it
+    static std::pair<bool, bool> ParseOneway(const std::shared_ptr<CStreetMap::SWay> &way) {
+        auto oneway = way->GetAttribute("oneway");
+        if (oneway == "yes" || oneway == "true" || oneway == "1") {
+            return {true, false};
+        }
+        if (oneway == "-1" || oneway == "reverse") {
+            return {false, true};
         }
+        return {true, true};
+    }
 
-        std::unordered_map<TNodeID, double> times; // create a map to store times
-        std::unordered_map<TNodeID, std::pair<ETransportationMode, TNodeID>> parents; // create a map to store parent nodes
-        std::priority_queue<std::pair<double, TNodeID>, std::vector<std::pair<double, TNodeID>>, std::greater<>> pq; // create a priority queue
+    // returns the number of nodes in the street map
+    std::size_t NodeCount() const noexcept {
+        return DNodeIDs.size();
+    }
     
-        // initialize structures
-        for (size_t i = 0; i < streetMap->NodeCount(); ++i) { // iterate through the nodes in the street map
-            TNodeID nodeID = streetMap->NodeByIndex(i)->ID(); // get the node ID
-            times[nodeID] = std::numeric_limits<double>::max(); // initialize the times to infinity
+    // returns the street map node specified by index
+    std::shared_ptr<CStreetMap::SNode> SortedNodeByIndex(std::size_t index) const noexcept {
+        if (index >= DNodeIDs.size()) { // check if the index is within bounds
+            return nullptr; // return nullptr if the index is out of bounds
         }
+        return DConfig->StreetMap()->NodeByIndex(DMapIndices[index]); // return the sorted node at the requested index
+    }
     
-        // initialize source node
-        times[src] = 0;
-        pq.push({0, src}); // push the source node to the priority queue
-    
-        while (!pq.empty()) { // iterate while the priority queue is not empty
-            auto [time, node] = pq.top(); // extract node with shortest time
-            pq.pop(); // remove the node from the priority queue
-    
-            if (node == dest) { // check if the destination node is reached
+    double FindShortestPath(TNodeID src, TNodeID dest, std::vector<TNodeID> &path) {
+        path.clear();
+        auto srcIndex = DNodeIndices.find(src); // look up the dense vertex IDs
+        auto destIndex = DNodeIndices.find(dest);
+        if (srcIndex == DNodeIndices.end() || destIndex == DNodeIndices.end()) {
+            return CPathRouter::NoPathExists; // return NoPathExists if either node is not in the map
+        }
+
+        // a finished hierarchy settles far fewer vertices than A*, which
+        // only steers the search when Precompute ran out of time
+        std::vector<CPathRouter::TVertexID> vertexPath;
+        double distance;
+        if (DStrategy == ESearchStrategy::AStar && !DHierarchyBuilt) {
+            distance = FindShortestPathAStar(srcIndex->second, destIndex->second, vertexPath);
+        } else {
+            distance = DShortestRouter.FindShortestPath(srcIndex->second, destIndex->second, vertexPath);
+            DSettledCount = DShortestRouter.SettledVertexCount();
+        }
+        if (distance == CPathRouter::NoPathExists) {
+            return CPathRouter::NoPathExists;
+        }
+        for (auto vertex : vertexPath) { // convert dense vertex IDs back to node IDs
+            path.push_back(DNodeIDs[vertex]);
+        }
+        return distance; // return the distance to the destination
+    }
+
+    // A* over the street segments, the straight line distance to dest never
+    // overestimates the remaining distance
+    double FindShortestPathAStar(std::size_t src, std::size_t dest, std::vector<CPathRouter::TVertexID> &path) {
+        static thread_local SSearchWorkspace<std::size_t> workspace; // distances and parent vertices, reused by every query on this thread
+        workspace.Reset(DNodeIDs.size());
+
+        workspace.Set(src, 0, CPathRouter::InvalidVertexID);
+        workspace.Push(SGeographicUtils::HaversineDistanceInMiles(DLocations[src], DLocations[dest]), 0, src); // keyed by the estimated total
+        std::size_t settled = 0;
+        while (!workspace.Empty()) {
+            auto entry = workspace.Pop();
+            std::size_t node = entry.DVertex;
+            if (node == dest) { // the first time dest is popped its distance is final
                 break;
             }
-            auto currentNode = streetMap->NodeByID(node); // get the current node
-            if (!currentNode) { // check if the current node is valid
+            if (entry.DCost > workspace.Cost(node)) { // skip stale queue entries
                 continue;
             }
-            // extract Speed from OSM Ways
-            for (size_t i = 0; i < streetMap->WayCount(); ++i) {
-                auto way = streetMap->WayByIndex(i); // get the way
-                if (!way) {
-                    continue;
+            ++settled;
+            for (const auto &edge : DAdjacency[node]) {
+                double newDistance = entry.DCost + edge.DDistance;
+                if (newDistance < workspace.Cost(edge.DDest)) { // vertices may be reopened with a shorter distance
+                    workspace.Set(edge.DDest, newDistance, node);
+                    workspace.Push(newDistance + SGeographicUtils::HaversineDistanceInMiles(DLocations[edge.DDest], DLocations[dest]), newDistance, edge.DDest);
                 }
-                double speed = DConfig->DefaultSpeedLimit(); // get the default speed limit
-                if (way->HasAttribute("maxspeed")) { // check if the way has a maxspeed attribute
-                    std::string speed_str = way->GetAttribute("maxspeed"); // get the maxspeed attribute
-                    if (speed_str.find("mph") != std::string::npos) { // check if the speed is in mph
-                        speed = std::stod(speed_str.substr(0, speed_str.find("mph"))); // convert the speed to double
-                    }
+            }
+        }
+        DSettledCount = settled;
+        if (!workspace.Reached(dest)) {
+            return CPathRouter::NoPathExists;
+        }
+        for (std::size_t current = dest; current != CPathRouter::InvalidVertexID; current = workspace.Parent(current)) {
+            path.push_back(current);
+        }
+        std::reverse(path.begin(), path.end());
+        return workspace.Cost(dest);
+    }
+
+    double FindFastestPath(TNodeID src, TNodeID dest, std::vector<TTripStep> &path) {
+        path.clear();
+        auto srcIndex = DNodeIndices.find(src); // look up the dense vertex IDs
+        auto destIndex = DNodeIndices.find(dest);
+        if (srcIndex == DNodeIndices.end() || destIndex == DNodeIndices.end()) {
+            return CPathRouter::NoPathExists; // return NoPathExists if a node is missing
+        }
+        const ESearchStrategy strategy = DStrategy;
+        if (strategy == ESearchStrategy::Raptor) {
+            DSettledCount = 0;
+            return FindFastestPathRaptor(srcIndex->second, destIndex->second, path);
+        }
+
+        // time to reach each transit graph vertex and its parent vertex, reused by every query on this thread
+        static thread_local SSearchWorkspace<std::size_t> workspace;
+        workspace.Reset(DTransitRows.size() - 1);
+        const auto &destLocation = DLocations[destIndex->second];
+        const double walkSpeed = DConfig->WalkSpeed(), bikeSpeed = DConfig->BikeSpeed();
+        const double stopTime = DConfig->BusStopTime() / 3600.0;
+        const bool buses = !DRouteStops.empty();
+        // the A* estimate bounds each layer by the modes still open to it. A
+        // bike never boards, a bus covers the rest at most at DMaxSpeed, and
+        // a walker either walks all the way or pays to board first.
+        auto estimate = [&](std::size_t vertex) {
+            double distance = SGeographicUtils::HaversineDistanceInMiles(VertexLocation(vertex), destLocation);
+            if (vertex >= RouteVertex(0)) {
+                return distance / DMaxSpeed;
+            }
+            if (vertex >= BikeVertex(0)) {
+                return distance / bikeSpeed;
+            }
+            return buses ? std::min(distance / walkSpeed, stopTime + distance / DMaxSpeed) : distance / walkSpeed;
+        };
+        // queue entries are keyed by the estimated total, plain Dijkstra estimates no remaining time
+        auto update = [&](std::size_t vertex, double time, std::size_t parent) {
+            double remaining = strategy == ESearchStrategy::AStar ? estimate(vertex) : 0.0;
+            workspace.Set(vertex, time, parent);
+            workspace.Push(time + remaining, time, vertex);
+        };
+
+        // the trip sets off on foot or by bike, and ends at dest in either layer
+        update(srcIndex->second, 0, CPathRouter::InvalidVertexID);
+        update(BikeVertex(srcIndex->second), 0, CPathRouter::InvalidVertexID);
+        std::size_t reached = CPathRouter::InvalidVertexID, settled = 0;
+        while (!workspace.Empty()) { // iterate while the priority queue is not empty
+            auto entry = workspace.Pop(); // extract the vertex with the shortest estimated time
+            std::size_t node = entry.DVertex;
+            if (entry.DCost > workspace.Cost(node)) { // skip stale queue entries
+                continue;
+            }
+            ++settled;
+            if (node == destIndex->second || node == BikeVertex(destIndex->second)) { // check if the destination is reached
+                reached = node;
+                break;
+            }
+            // relax the walking, biking, boarding, riding and alighting edges
+            for (auto index = DTransitRows[node]; index < DTransitRows[node + 1]; ++index) {
+                const auto &edge = DTransitEdges[index];
+                if (entry.DCost + edge.DTime < workspace.Cost(edge.DDest)) {
+                    update(edge.DDest, entry.DCost + edge.DTime, node);
                 }
-    
-                for (size_t j = 0; j < way->NodeCount() - 1; ++j) { // iterate through the nodes in the way
-                    TNodeID u = way->GetNodeID(j); // get the start node
-                    TNodeID v = way->GetNodeID(j + 1); // get the end node
-                    double distance = SGeographicUtils::HaversineDistanceInMiles(
-                        streetMap->NodeByID(u)->Location(), streetMap->NodeByID(v)->Location() // calculate the distance between the nodes
-                    );
-    
-                    double roadTime = distance / speed; // calculate the time to travel the road
-                
-                    if (times[u] + roadTime < times[v]) { // check if the new time is shorter
-                        times[v] = times[u] + roadTime; // update the time
-                        parents[v] = {ETransportationMode::Walk, u};  // update the parent node
-                        pq.push({times[v], v}); // push the node to the priority queue
+            }
+        }
+        DSettledCount = settled;
+        if (reached == CPathRouter::InvalidVertexID) {
+            return CPathRouter::NoPathExists;
+        }
+
+        // the layers of each vertex and its parent give the mode of each step
+        const std::size_t routeBase = RouteVertex(0);
+        std::size_t current = reached;
+        for (auto parent = workspace.Parent(current); parent != CPathRouter::InvalidVertexID; current = parent, parent = workspace.Parent(current)) {
+            if (parent >= routeBase) { // alighted here, or the bus stopped at a stop the rider stayed on through
+                path.push_back({ETransportationMode::Bus, DNodeIDs[StreetVertex(current)]});
+            } else if (current < routeBase) { // boarding adds no step
+                path.push_back({current < BikeVertex(0) ? ETransportationMode::Walk : ETransportationMode::Bike, DNodeIDs[StreetVertex(current)]});
+            }
+        }
+        path.push_back({current < BikeVertex(0) ? ETransportationMode::Walk : ETransportationMode::Bike, src});
+        std::reverse(path.begin(), path.end()); // reverse the path
+
+        return workspace.Cost(reached); // return the time to the destination
+    }
+
+    // RAPTOR over the routes, round k finds the earliest arrival at every
+    // stop with k rides. Riders walk from src to the stops they can reach
+    // before walking or biking all the way would get them to dest, transfer
+    // over the footpaths and walk from their last stop to dest. Buses run
+    // continuously, so boarding costs BusStopTime and never waits.
+    double FindFastestPathRaptor(std::size_t src, std::size_t dest, std::vector<TTripStep> &path) const {
+        static thread_local SSearchWorkspace<std::size_t> access, bike, egress, footpath; // street searches, reused by every query on this thread
+        static thread_local SRaptorWorkspace raptor;
+        const double infinity = std::numeric_limits<double>::infinity();
+        const double stopTime = DConfig->BusStopTime() / 3600.0;
+        const std::size_t stopCount = DRaptorStops.size();
+
+        // no journey slower than biking all the way can win, so the bike time
+        // bounds the walk to dest and to every stop worth walking to
+        SearchStreets(bike, BikeVertex(src), BikeVertex(dest), infinity);
+        SearchStreets(access, src, dest, bike.Cost(BikeVertex(dest)));
+        bool biking = bike.Cost(BikeVertex(dest)) < access.Cost(dest);
+        double best = std::min(access.Cost(dest), bike.Cost(BikeVertex(dest))); // walking or biking all the way
+        auto &arrivals = raptor.DArrivals;
+        auto &parents = raptor.DParents;
+        arrivals.assign(stopCount, infinity);
+        parents.assign(stopCount, {ERaptorStep::Access, 0, 0});
+        raptor.DBest.assign(stopCount, infinity);
+        raptor.DIsMarked.assign(stopCount, false);
+        raptor.DRouteStarts.assign(DRaptorRouteRows.empty() ? 0 : DRaptorRouteRows.size() - 1, CPathRouter::InvalidVertexID);
+        raptor.DMarked.clear();
+        double earliest = infinity; // earliest arrival at any stop
+        for (std::size_t stop = 0; stop < stopCount; ++stop) {
+            double time = access.Cost(DRaptorStops[stop]);
+            if (time < best) {
+                arrivals[stop] = raptor.DBest[stop] = time;
+                raptor.DMarked.push_back(stop);
+                earliest = std::min(earliest, time);
+            }
+        }
+        // a ride only helps if the walk from its last stop is shorter than this
+        SearchStreets(egress, dest, CPathRouter::InvalidVertexID, best - earliest - stopTime);
+        std::size_t bestStop = CPathRouter::InvalidVertexID, bestRound = 0; // stop the rider walks to dest from
+        for (std::size_t round = 1; round <= MaxRaptorRounds && !raptor.DMarked.empty(); ++round) {
+            const std::size_t previous = (round - 1) * stopCount, current = round * stopCount;
+            arrivals.resize(current + stopCount);
+            parents.resize(current + stopCount);
+            std::copy(arrivals.begin() + previous, arrivals.begin() + current, arrivals.begin() + current);
+            std::fill(parents.begin() + current, parents.end(), SRaptorParent{ERaptorStep::Copy, 0, 0});
+
+            // scan each route from the earliest stop improved in the last round
+            raptor.DQueuedRoutes.clear();
+            for (auto stop : raptor.DMarked) {
+                raptor.DIsMarked[stop] = false;
+                for (auto index = DRaptorVisitRows[stop]; index < DRaptorVisitRows[stop + 1]; ++index) {
+                    auto &start = raptor.DRouteStarts[DRaptorVisits[index].first];
+                    if (start == CPathRouter::InvalidVertexID) {
+                        raptor.DQueuedRoutes.push_back(DRaptorVisits[index].first);
+                        start = DRaptorVisits[index].second;
+                    } else {
+                        start = std::min(start, DRaptorVisits[index].second);
                     }
                 }
             }
-    
-            // Ensure stop is valid before using it
-            auto stop = FindStopByNodeID(node, busSystem); // find the bus stop at the current node
-            if (stop) { // check if the bus stop is valid
-                for (size_t i = 0; i < busSystem->RouteCount(); ++i) { // iterate through the routes in the bus system
-                    auto route = busSystem->RouteByIndex(i); // get the route
-                    if (!route) { // check if the route is valid
-                        continue;
+            raptor.DMarked.clear();
+            for (auto route : raptor.DQueuedRoutes) {
+                double onboard = infinity; // time the bus is at the position
+                std::size_t boarded = CPathRouter::InvalidVertexID;
+                for (auto position = raptor.DRouteStarts[route]; position < DRaptorRouteRows[route + 1]; ++position) {
+                    std::size_t stop = DRaptorRouteStops[position];
+                    if (onboard < raptor.DBest[stop] && onboard < best) {
+                        arrivals[current + stop] = raptor.DBest[stop] = onboard;
+                        parents[current + stop] = {ERaptorStep::Ride, boarded, position};
+                        if (!raptor.DIsMarked[stop]) {
+                            raptor.DIsMarked[stop] = true;
+                            raptor.DMarked.push_back(stop);
+                        }
+                    }
+                    if (arrivals[previous + stop] < onboard) { // catching the bus here is earlier
+                        onboard = arrivals[previous + stop];
+                        boarded = position;
                     }
+                    onboard += stopTime + DRaptorRideTimes[position];
+                }
+                raptor.DRouteStarts[route] = CPathRouter::InvalidVertexID;
+            }
 
-                    for (size_t j = 0; j < route->StopCount() - 1; ++j) { // iterate through the stops in the route
-                        TNodeID busSrc = route->GetStopID(j); // get the start stop
-                        TNodeID busDest = route->GetStopID(j + 1); // get the end stop
-                        
-                        double distance = SGeographicUtils::HaversineDistanceInMiles(
-                            streetMap->NodeByID(busSrc)->Location(), 
-                            streetMap->NodeByID(busDest)->Location()
-                        );
-                        
-                        double busSpeed = DConfig->DefaultSpeedLimit(); // get the default speed limit
-                        double busTime = (distance / busSpeed) + (DConfig->BusStopTime() / 3600.0); // calculate the time to travel the road and stop time
-    
-                        if (times[busSrc] + busTime < times[busDest]) {
-                            times[busDest] = times[busSrc] + busTime; // update the time
-                            parents[busDest] = {ETransportationMode::Bus, busSrc}; // update the parent node
-                            pq.push({times[busDest], busDest}); // push the node to the priority queue
+            // then walk on from the stops the buses reached
+            for (std::size_t index = 0, count = raptor.DMarked.size(); index < count; ++index) {
+                std::size_t stop = raptor.DMarked[index];
+                for (auto edge = DRaptorFootpathRows[stop]; edge < DRaptorFootpathRows[stop + 1]; ++edge) {
+                    std::size_t other = DRaptorFootpaths[edge].first;
+                    double time = arrivals[current + stop] + DRaptorFootpaths[edge].second;
+                    if (time < raptor.DBest[other] && time < best) {
+                        arrivals[current + other] = raptor.DBest[other] = time;
+                        parents[current + other] = {ERaptorStep::Footpath, stop, 0};
+                        if (!raptor.DIsMarked[other]) {
+                            raptor.DIsMarked[other] = true;
+                            raptor.DMarked.push_back(other);
                         }
                     }
                 }
             }
+            for (auto stop : raptor.DMarked) {
+                double time = arrivals[current + stop] + egress.Cost(DRaptorStops[stop]);
+                if (time < best) {
+                    best = time;
+                    bestStop = stop;
+                    bestRound = round;
+                }
+            }
         }
-    
-        // ensure dest was updated in times before path reconstruction
-        if (times[dest] == std::numeric_limits<double>::max()) {
+        for (auto stop : raptor.DMarked) {
+            raptor.DIsMarked[stop] = false;
+        }
+        if (best == infinity) {
             return CPathRouter::NoPathExists;
         }
-        // ensure parents[current] exists before accessing .second
-        TNodeID current = dest;
-        if (parents.find(current) == parents.end()) { // check if the parent node exists
-            return CPathRouter::NoPathExists; // return NoPathExists if the parent node does not exist
+
+        // the steps are collected from dest back to src
+        if (bestStop == CPathRouter::InvalidVertexID && biking) {
+            AppendStreetSteps(bike, BikeVertex(src), BikeVertex(dest), path);
+        } else if (bestStop == CPathRouter::InvalidVertexID) {
+            AppendStreetSteps(access, src, dest, path);
+        } else {
+            std::vector<TTripStep> walk;
+            for (auto vertex = DRaptorStops[bestStop]; vertex != dest;) {
+                vertex = egress.Parent(vertex);
+                walk.push_back({ETransportationMode::Walk, DNodeIDs[vertex]});
+            }
+            path.insert(path.end(), walk.rbegin(), walk.rend());
+            std::size_t stop = bestStop, round = bestRound;
+            while (round > 0) {
+                const auto &parent = parents[round * stopCount + stop];
+                if (parent.DStep == ERaptorStep::Copy) {
+                    --round;
+                } else if (parent.DStep == ERaptorStep::Ride) {
+                    for (auto position = parent.DTo; position > parent.DFrom; --position) {
+                        path.push_back({ETransportationMode::Bus, DNodeIDs[DRaptorStops[DRaptorRouteStops[position]]]});
+                    }
+                    stop = DRaptorRouteStops[parent.DFrom];
+                    --round;
+                } else {
+                    SearchStreets(footpath, DRaptorStops[parent.DFrom], DRaptorStops[stop], MaxTransferTime);
+                    AppendStreetSteps(footpath, DRaptorStops[parent.DFrom], DRaptorStops[stop], path);
+                    stop = parent.DFrom;
+                }
+            }
+            AppendStreetSteps(access, src, DRaptorStops[stop], path);
+        }
+        path.push_back({bestStop == CPathRouter::InvalidVertexID && biking ? ETransportationMode::Bike : ETransportationMode::Walk, DNodeIDs[src]});
+        std::reverse(path.begin(), path.end());
+        return best;
+    }
+
+    // adds the walk or bike ride from the layer vertex from to the layer
+    // vertex to that a street search from from found, as steps from to back
+    // to from
+    void AppendStreetSteps(const SSearchWorkspace<std::size_t> &workspace, std::size_t from, std::size_t to, std::vector<TTripStep> &path) const {
+        for (auto vertex = to; vertex != from; vertex = workspace.Parent(vertex)) {
+            path.push_back({vertex < BikeVertex(0) ? ETransportationMode::Walk : ETransportationMode::Bike, DNodeIDs[StreetVertex(vertex)]});
         }
-    
-        while (current != src) { // iterate from destination to source
-            if (parents.find(current) == parents.end()) { // check if the parent node exists  
-                return CPathRouter::NoPathExists; // return NoPathExists if the parent node does not exist
+    }
+
+    // McRAPTOR over the routes, round k keeps every journey to a stop with k
+    // rides unless one with as many or fewer rides gets there as early while
+    // walking at most OptionWalkSlack more. Walking, footpaths and buses work
+    // as in FindFastestPathRaptor.
+    std::vector<SPathOption> FindFastestPathOptions(TNodeID src, TNodeID dest) {
+        std::vector<SPathOption> options;
+        auto srcIndex = DNodeIndices.find(src);
+        auto destIndex = DNodeIndices.find(dest);
+        if (srcIndex == DNodeIndices.end() || destIndex == DNodeIndices.end()) {
+            return options;
+        }
+        std::call_once(DRaptorBuilt, [this]() { BuildRaptorTables(); });
+
+        static thread_local SSearchWorkspace<std::size_t> access, bike, egress, footpath; // street searches, reused by every query on this thread
+        static thread_local SOptionWorkspace workspace;
+        const double infinity = std::numeric_limits<double>::infinity();
+        const double stopTime = DConfig->BusStopTime() / 3600.0;
+        const std::size_t stopCount = DRaptorStops.size();
+        auto &labels = workspace.DLabels;
+        auto &targets = workspace.DTargets;
+        auto &bags = workspace.DBags;
+        if (bags.size() < stopCount) {
+            bags.resize(stopCount);
+            workspace.DPrevious.resize(stopCount);
+            workspace.DCurrent.resize(stopCount);
+        }
+        for (auto stop : workspace.DTouched) {
+            bags[stop].clear();
+            workspace.DPrevious[stop].clear();
+            workspace.DCurrent[stop].clear();
+        }
+        workspace.DTouched.clear();
+        workspace.DMarked.clear();
+        workspace.DPreviousMarked.clear();
+        labels.clear();
+        targets.clear();
+        workspace.DRouteStarts.assign(DRaptorRouteRows.empty() ? 0 : DRaptorRouteRows.size() - 1, CPathRouter::InvalidVertexID);
+
+        // the rides never decrease from round to round, so a journey that
+        // walks on to dest no later and barely longer beats every extension
+        auto dominated = [&](double arrival, double walk) {
+            for (const auto &target : targets) {
+                if (target.DActive && target.DArrival <= arrival && target.DWalk <= walk + OptionWalkSlack) {
+                    return true;
+                }
             }
-    
-            path.push_back({parents[current].first, current}); // add the node to the path
-            current = parents[current].second; // move to the parent node
+            return false;
+        };
+        auto addTarget = [&](double arrival, double walk, std::size_t round, std::size_t label) {
+            if (dominated(arrival, walk)) {
+                return;
+            }
+            for (auto &target : targets) {
+                if (target.DRound == round && arrival <= target.DArrival && walk <= target.DWalk + OptionWalkSlack) {
+                    target.DActive = false;
+                }
+            }
+            targets.push_back({arrival, walk, round, label, true});
+        };
+        auto addLabel = [&](const SOptionLabel &label) {
+            if (dominated(label.DArrival, label.DWalk)) {
+                return;
+            }
+            auto &bag = bags[label.DStop];
+            for (auto index : bag) {
+                if (labels[index].DArrival <= label.DArrival && labels[index].DWalk <= label.DWalk + OptionWalkSlack) {
+                    return;
+                }
+            }
+            if (bag.empty()) {
+                workspace.DTouched.push_back(label.DStop);
+            }
+            bag.erase(std::remove_if(bag.begin(), bag.end(), [&](std::size_t index) {
+                if (labels[index].DRound == label.DRound && label.DArrival <= labels[index].DArrival && label.DWalk <= labels[index].DWalk + OptionWalkSlack) {
+                    labels[index].DActive = false;
+                    return true;
+                }
+                return false;
+            }), bag.end());
+            bag.push_back(labels.size());
+            if (workspace.DCurrent[label.DStop].empty()) {
+                workspace.DMarked.push_back(label.DStop);
+            }
+            workspace.DCurrent[label.DStop].push_back(labels.size());
+            labels.push_back(label);
+        };
+
+        SearchStreets(access, srcIndex->second, destIndex->second, infinity);
+        SearchStreets(bike, BikeVertex(srcIndex->second), BikeVertex(destIndex->second), infinity);
+        double walkOnly = access.Cost(destIndex->second), bikeOnly = bike.Cost(BikeVertex(destIndex->second));
+        if (walkOnly < infinity) {
+            addTarget(walkOnly, walkOnly, 0, destIndex->second);
         }
-    
-        path.push_back({ETransportationMode::Walk, src}); // add the source node to the path
-        std::reverse(path.begin(), path.end()); // reverse the path
-    
-        return times[dest]; // return the time to the destination
+        if (bikeOnly < infinity) {
+            addTarget(bikeOnly, 0.0, 0, BikeVertex(destIndex->second));
+        }
+        double earliest = infinity; // earliest arrival at any stop
+        for (std::size_t stop = 0; stop < stopCount; ++stop) {
+            double time = access.Cost(DRaptorStops[stop]);
+            if (time < infinity) {
+                addLabel({time, time, stop, 0, ERaptorStep::Access, CPathRouter::InvalidVertexID, 0, 0, true});
+                earliest = std::min(earliest, time);
+            }
+        }
+        // a stop further than this from dest only leads to journeys walking
+        // longer and arriving later than walking all the way, or arriving
+        // later than biking
+        SearchStreets(egress, destIndex->second, CPathRouter::InvalidVertexID, std::min(walkOnly, bikeOnly) - earliest);
+
+        for (std::size_t round = 1; round <= MaxRaptorRounds && !workspace.DMarked.empty(); ++round) {
+            std::swap(workspace.DPrevious, workspace.DCurrent);
+            std::swap(workspace.DPreviousMarked, workspace.DMarked);
+            for (auto stop : workspace.DMarked) {
+                workspace.DCurrent[stop].clear();
+            }
+            workspace.DMarked.clear();
+
+            // scan each route from the earliest stop that gained labels in the last round
+            workspace.DQueuedRoutes.clear();
+            for (auto stop : workspace.DPreviousMarked) {
+                for (auto index = DRaptorVisitRows[stop]; index < DRaptorVisitRows[stop + 1]; ++index) {
+                    auto &start = workspace.DRouteStarts[DRaptorVisits[index].first];
+                    if (start == CPathRouter::InvalidVertexID) {
+                        workspace.DQueuedRoutes.push_back(DRaptorVisits[index].first);
+                        start = DRaptorVisits[index].second;
+                    } else {
+                        start = std::min(start, DRaptorVisits[index].second);
+                    }
+                }
+            }
+            const std::size_t firstRide = labels.size();
+            auto &trips = workspace.DTrips;
+            for (auto route : workspace.DQueuedRoutes) {
+                trips.clear();
+                for (auto position = workspace.DRouteStarts[route]; position < DRaptorRouteRows[route + 1]; ++position) {
+                    std::size_t stop = DRaptorRouteStops[position];
+                    for (const auto &trip : trips) {
+                        addLabel({trip.DArrival, trip.DWalk, stop, round, ERaptorStep::Ride, trip.DLabel, trip.DBoarded, position, true});
+                    }
+                    // riders waiting here board unless a rider already on the bus is as early with as little walking
+                    for (auto index : workspace.DPrevious[stop]) {
+                        const auto &label = labels[index];
+                        if (!label.DActive || std::any_of(trips.begin(), trips.end(), [&](const SOptionTrip &trip) {
+                                return trip.DArrival <= label.DArrival && trip.DWalk <= label.DWalk + OptionWalkSlack;
+                            })) {
+                            continue;
+                        }
+                        trips.erase(std::remove_if(trips.begin(), trips.end(), [&](const SOptionTrip &trip) {
+                            return label.DArrival <= trip.DArrival && label.DWalk <= trip.DWalk + OptionWalkSlack;
+                        }), trips.end());
+                        trips.push_back({label.DArrival, label.DWalk, index, position});
+                    }
+                    for (auto &trip : trips) {
+                        trip.DArrival += stopTime + DRaptorRideTimes[position];
+                    }
+                }
+                workspace.DRouteStarts[route] = CPathRouter::InvalidVertexID;
+            }
+
+            // then walk on from the stops the buses reached
+            for (std::size_t index = firstRide, count = labels.size(); index < count; ++index) {
+                if (!labels[index].DActive) {
+                    continue;
+                }
+                std::size_t stop = labels[index].DStop;
+                for (auto edge = DRaptorFootpathRows[stop]; edge < DRaptorFootpathRows[stop + 1]; ++edge) {
+                    double time = DRaptorFootpaths[edge].second;
+                    addLabel({labels[index].DArrival + time, labels[index].DWalk + time, DRaptorFootpaths[edge].first, round, ERaptorStep::Footpath, index, 0, 0, true});
+                }
+            }
+            for (auto stop : workspace.DMarked) {
+                double time = egress.Cost(DRaptorStops[stop]);
+                for (auto index : workspace.DCurrent[stop]) {
+                    if (labels[index].DActive && time < infinity) {
+                        addTarget(labels[index].DArrival + time, labels[index].DWalk + time, round, index);
+                    }
+                }
+            }
+        }
+
+        // the steps of each journey are collected from dest back to src
+        for (const auto &target : targets) {
+            if (!target.DActive) {
+                continue;
+            }
+            SPathOption option{target.DArrival, target.DRound, target.DWalk, {}};
+            auto &path = option.DPath;
+            if (target.DRound == 0 && target.DLabel == BikeVertex(destIndex->second)) {
+                AppendStreetSteps(bike, BikeVertex(srcIndex->second), target.DLabel, path);
+            } else if (target.DRound == 0) {
+                AppendStreetSteps(access, srcIndex->second, target.DLabel, path);
+            } else {
+                std::size_t index = target.DLabel;
+                std::vector<TTripStep> walk;
+                for (auto vertex = DRaptorStops[labels[index].DStop]; vertex != destIndex->second;) {
+                    vertex = egress.Parent(vertex);
+                    walk.push_back({ETransportationMode::Walk, DNodeIDs[vertex]});
+                }
+                path.insert(path.end(), walk.rbegin(), walk.rend());
+                for (; labels[index].DStep != ERaptorStep::Access; index = labels[index].DParent) {
+                    const auto &label = labels[index];
+                    if (label.DStep == ERaptorStep::Ride) {
+                        for (auto position = label.DTo; position > label.DFrom; --position) {
+                            path.push_back({ETransportationMode::Bus, DNodeIDs[DRaptorStops[DRaptorRouteStops[position]]]});
+                        }
+                    } else {
+                        std::size_t from = DRaptorStops[labels[label.DParent].DStop], to = DRaptorStops[label.DStop];
+                        SearchStreets(footpath, from, to, MaxTransferTime);
+                        AppendStreetSteps(footpath, from, to, path);
+                    }
+                }
+                AppendStreetSteps(access, srcIndex->second, DRaptorStops[labels[index].DStop], path);
+            }
+            path.push_back({target.DRound == 0 && target.DLabel == BikeVertex(destIndex->second) ? ETransportationMode::Bike : ETransportationMode::Walk, src});
+            std::reverse(path.begin(), path.end());
+            options.push_back(std::move(option));
+        }
+        return options;
     }
 
-    
+    // calls query(index) for every index below count, the queries are handed
+    // out one at a time to threadcount workers including the calling thread
+    template <typename TQueryFunction>
+    static void RunBatch(std::size_t count, std::size_t threadcount, TQueryFunction query) {
+        if (threadcount == 0) {
+            threadcount = std::max(1u, std::thread::hardware_concurrency());
+        }
+        threadcount = std::min(threadcount, count);
+        std::atomic<std::size_t> next = 0; // next query to hand out
+        std::exception_ptr failure; // first exception thrown by a worker
+        std::mutex failureMutex;
+        auto worker = [&]() {
+            try {
+                for (std::size_t index = next++; index < count; index = next++) {
+                    query(index);
+                }
+            }
+            catch (...) {
+                std::lock_guard<std::mutex> lock(failureMutex);
+                if (!failure) {
+                    failure = std::current_exception();
+                }
+                next = count; // stop the other workers
+            }
+        };
+        std::vector<std::thread> workers;
+        for (std::size_t index = 1; index < threadcount; index++) {
+            workers.emplace_back(worker);
+        }
+        worker();
+        for (auto &thread : workers) {
+            thread.join();
+        }
+        if (failure) {
+            std::rethrow_exception(failure);
+        }
+    }
+
+    std::vector<double> FindShortestPaths(const std::vector<TQuery> &queries, std::vector<std::vector<TNodeID>> &paths, std::size_t threadcount) {
+        std::vector<double> distances(queries.size());
+        paths.assign(queries.size(), {});
+        RunBatch(queries.size(), threadcount, [&](std::size_t index) {
+            distances[index] = FindShortestPath(queries[index].first, queries[index].second, paths[index]);
+        });
+        return distances;
+    }
+
+    std::vector<double> FindFastestPaths(const std::vector<TQuery> &queries, std::vector<std::vector<TTripStep>> &paths, std::size_t threadcount) {
+        std::vector<double> times(queries.size());
+        paths.assign(queries.size(), {});
+        RunBatch(queries.size(), threadcount, [&](std::size_t index) {
+            times[index] = FindFastestPath(queries[index].first, queries[index].second, paths[index]);
+        });
+        return times;
+    }
+
+    // key of the segment between two street vertices, the same either way
+    uint64_t SegmentKey(std::size_t u, std::size_t v) const {
+        return uint64_t(std::min(u, v)) * DNodeIDs.size() + std::max(u, v);
+    }
+
+    // records the way of every segment, the first way to use a segment wins
+    void BuildSegmentWays() const {
+        auto streetMap = DConfig->StreetMap();
+        for (std::size_t i = 0; i < streetMap->WayCount(); ++i) {
+            auto way = streetMap->WayByIndex(i);
+            for (std::size_t j = 0; way && j + 1 < way->NodeCount(); ++j) {
+                auto u = DNodeIndices.find(way->GetNodeID(j));
+                auto v = DNodeIndices.find(way->GetNodeID(j + 1));
+                if (u != DNodeIndices.end() && v != DNodeIndices.end()) {
+                    DSegmentWays.emplace(SegmentKey(u->second, v->second), i);
+                }
+            }
+        }
+    }
+
+    // name of the street the segment between u and v is on, empty if it has none
+    std::string StreetName(std::size_t u, std::size_t v) const {
+        auto search = DSegmentWays.find(SegmentKey(u, v));
+        if (search == DSegmentWays.end()) {
+            return "";
+        }
+        auto way = DConfig->StreetMap()->WayByIndex(search->second);
+        return way ? way->GetAttribute("name") : "";
+    }
+
+    // stretch of a described path, either steps in one mode along one street
+    // or a ride on one route
+    struct SPathStretch {
+        ETransportationMode DMode;
+        std::size_t DBegin; // position in the path of the first node
+        std::size_t DEnd; // position in the path of the last node
+        std::string DName; // street name, or route name of a ride
+        CBusSystem::TStopID DFromStop = 0; // stops a ride boards and alights at
+        CBusSystem::TStopID DToStop = 0;
+    };
+
+    // finds the route that carries the rider through the most bus steps from
+    // the node at begin, the first route wins a tie
+    bool FindRide(const std::vector<TTripStep> &path, std::size_t begin, SPathStretch &ride) const {
+        ride = {ETransportationMode::Bus, begin, begin, "", 0, 0};
+        for (std::size_t i = 0; DBusSystem && i < DBusSystem->RouteCount(); ++i) {
+            auto route = DBusSystem->RouteByIndex(i);
+            auto stopNode = [&](std::size_t index) {
+                auto stop = DBusSystem->StopByID(route->GetStopID(index));
+                return stop ? stop->NodeID() : CStreetMap::InvalidNodeID;
+            };
+            for (std::size_t start = 0; route && start < route->StopCount(); ++start) {
+                if (stopNode(start) != path[begin].second) {
+                    continue;
+                }
+                std::size_t count = 0;
+                while (begin + count + 1 < path.size() && start + count + 1 < route->StopCount() &&
+                       path[begin + count + 1].first == ETransportationMode::Bus && stopNode(start + count + 1) == path[begin + count + 1].second) {
+                    ++count;
+                }
+                if (begin + count > ride.DEnd) {
+                    ride = {ETransportationMode::Bus, begin, begin + count, route->Name(), route->GetStopID(start), route->GetStopID(start + count)};
+                }
+            }
+        }
+        return ride.DEnd > begin;
+    }
+
+    // describes the path as where it starts, one line per street or ride and
+    // where it ends. A street without a name is described by where it leads,
+    // the next named street, the stop of the next ride or the end.
     bool GetPathDescription(const std::vector<TTripStep> &path, std::vector<std::string> &desc) const {
-        for (const auto& step : path) {
-            std::string mode;
-            switch (step.first) {
-                case ETransportationMode::Walk: mode = "Walk"; break;
-                case ETransportationMode::Bike: mode = "Bike"; break;
-                case ETransportationMode::Bus: mode = "Take bus"; break;
+        desc.clear();
+        std::vector<std::size_t> vertices;
+        for (const auto &step : path) {
+            auto search = DNodeIndices.find(step.second);
+            if (search == DNodeIndices.end()) {
+                return false;
+            }
+            vertices.push_back(search->second);
+        }
+        if (vertices.empty()) {
+            return false;
+        }
+        std::call_once(DSegmentWaysBuilt, [this]() { BuildSegmentWays(); });
+
+        // consecutive steps in the same mode along the same street are one stretch
+        std::vector<SPathStretch> stretches;
+        for (std::size_t position = 1; position < path.size();) {
+            if (path[position].first == ETransportationMode::Bus) {
+                SPathStretch ride;
+                if (!FindRide(path, position - 1, ride)) {
+                    return false;
+                }
+                stretches.push_back(ride);
+                position = ride.DEnd + 1;
+                continue;
+            }
+            auto name = StreetName(vertices[position - 1], vertices[position]);
+            if (!stretches.empty() && stretches.back().DMode == path[position].first && stretches.back().DName == name) {
+                stretches.back().DEnd = position;
+            } else {
+                stretches.push_back({path[position].first, position - 1, position, name});
+            }
+            ++position;
+        }
+
+        desc.push_back("Start at " + SGeographicUtils::ConvertLLToDMS(DLocations[vertices.front()]));
+        for (std::size_t index = 0; index < stretches.size(); ++index) {
+            const auto &stretch = stretches[index];
+            if (stretch.DMode == ETransportationMode::Bus) {
+                desc.push_back("Take Bus " + stretch.DName + " from stop " + std::to_string(stretch.DFromStop) + " to stop " + std::to_string(stretch.DToStop));
+                continue;
+            }
+            double distance = 0.0;
+            for (auto position = stretch.DBegin; position < stretch.DEnd; ++position) {
+                distance += SGeographicUtils::HaversineDistanceInMiles(DLocations[vertices[position]], DLocations[vertices[position + 1]]);
             }
-            desc.push_back(mode + " to node " + std::to_string(step.second));
+            std::string street = "along " + stretch.DName;
+            if (stretch.DName.empty()) {
+                street = "toward End";
+                for (auto next = index + 1; next < stretches.size(); ++next) {
+                    if (stretches[next].DMode == ETransportationMode::Bus) {
+                        street = "toward stop " + std::to_string(stretches[next].DFromStop);
+                        break;
+                    }
+                    if (!stretches[next].DName.empty()) {
+                        street = "toward " + stretches[next].DName;
+                        break;
+                    }
+                }
+            }
+            std::stringstream line;
+            line << (stretch.DMode == ETransportationMode::Walk ? "Walk " : "Bike ")
+                 << SGeographicUtils::BearingToDirection(SGeographicUtils::CalculateBearing(DLocations[vertices[stretch.DBegin]], DLocations[vertices[stretch.DEnd]]))
+                 << " " << street << " for " << std::fixed << std::setprecision(1) << distance << " mi";
+            desc.push_back(line.str());
         }
+        desc.push_back("End at " + SGeographicUtils::ConvertLLToDMS(DLocations[vertices.back()]));
         return true;
     }
 };
@@ -269,11 +1679,54 @@ CDijkstraTransportationPlanner::CDijkstraTransportationPlanner(std::shared_ptr<S
     DImplementation = std::make_unique<SImplementation>(config); // create the implementation object
 }
 
+// creates an empty planner for LoadSnapshot to fill in
+CDijkstraTransportationPlanner::CDijkstraTransportationPlanner() {
+    DImplementation = std::make_unique<SImplementation>();
+}
+
+// writes the configuration, street map, bus system and the built graph with
+// any precomputed hierarchy, so LoadSnapshot can skip parsing and building
+bool CDijkstraTransportationPlanner::WriteSnapshot(std::shared_ptr<CDataSink> sink) {
+    return DImplementation->WriteSnapshot(sink);
+}
+
+// loads a planner from a snapshot file written by WriteSnapshot, the file is
+// memory mapped so processes loading the same snapshot share its pages,
+// nullptr is returned if the snapshot is missing, damaged or outdated
+std::shared_ptr<CDijkstraTransportationPlanner> CDijkstraTransportationPlanner::LoadSnapshot(const std::string &filename) {
+    try {
+        CSnapshotReader Reader(filename);
+        std::shared_ptr<CDijkstraTransportationPlanner> Planner(new CDijkstraTransportationPlanner());
+        if (!Planner->DImplementation->ReadSnapshot(Reader)) {
+            return nullptr;
+        }
+        return Planner;
+    }
+    catch (const std::exception &) { // a damaged count can still ask for more memory than there is
+        return nullptr;
+    }
+}
+
 // destructor
 CDijkstraTransportationPlanner::~CDijkstraTransportationPlanner() {
 
 }
 
+// selects the search used by FindShortestPath and FindFastestPath
+void CDijkstraTransportationPlanner::SetSearchStrategy(ESearchStrategy strategy) {
+    DImplementation->SetSearchStrategy(strategy);
+}
+
+// returns the search used by FindShortestPath and FindFastestPath
+CDijkstraTransportationPlanner::ESearchStrategy CDijkstraTransportationPlanner::SearchStrategy() const noexcept {
+    return DImplementation->DStrategy;
+}
+
+// returns the vertices settled by the last FindShortestPath or FindFastestPath
+std::size_t CDijkstraTransportationPlanner::SettledVertexCount() const noexcept {
+    return DImplementation->DSettledCount;
+}
+
 // returns the number of nodes in the street map
 std::size_t CDijkstraTransportationPlanner::NodeCount() const noexcept {
     return DImplementation->NodeCount();
@@ -294,7 +1747,24 @@ double CDijkstraTransportationPlanner::FindFastestPath(TNodeID src, TNodeID dest
     return DImplementation->FindFastestPath(src, dest, path);
 }
 
+// finds the shortest path of every query, the planner must not be changed
+// while the batch runs
+std::vector<double> CDijkstraTransportationPlanner::FindShortestPaths(const std::vector<TQuery> &queries, std::vector<std::vector<TNodeID>> &paths, std::size_t threadcount) {
+    return DImplementation->FindShortestPaths(queries, paths, threadcount);
+}
+
+// finds the fastest path of every query, the planner must not be changed
+// while the batch runs
+std::vector<double> CDijkstraTransportationPlanner::FindFastestPaths(const std::vector<TQuery> &queries, std::vector<std::vector<TTripStep>> &paths, std::size_t threadcount) {
+    return DImplementation->FindFastestPaths(queries, paths, threadcount);
+}
+
 // converts path to readable format
 bool CDijkstraTransportationPlanner::GetPathDescription(const std::vector<TTripStep> &path, std::vector<std::string> &desc) const {
     return DImplementation->GetPathDescription(path, desc);
 }
+
+// finds the journeys that trade travel time against rides and walking
+std::vector<CDijkstraTransportationPlanner::SPathOption> CDijkstraTransportationPlanner::FindFastestPathOptions(TNodeID src, TNodeID dest) {
+    return DImplementation->FindFastestPathOptions(src, dest);
+}
@@ -1,5 +1,6 @@
 #include "FileDataFactory.h"
 #include "FileDataSource.h"
+#include "MemoryMappedDataSource.h"
 #include "FileDataSink.h"
 #include <filesystem>
 
@@ -13,6 +14,11 @@ CFileDataFactory::CFileDataFactory(const std::string &path){
 }
 
 std::shared_ptr< CDataSource > CFileDataFactory::CreateSource(const std::string &name) noexcept{
+    // regular files are mapped, anything that cannot be mapped is streamed
+    auto MappedSource = std::make_shared<CMemoryMappedDataSource>(DBasePath + name);
+    if(MappedSource->Valid()){
+        return MappedSource;
+    }
     return std::make_shared<CFileDataSource>(DBasePath + name);
 }
 
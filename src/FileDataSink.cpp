@@ -1,16 +1,7 @@
 #include "FileDataSink.h"
+#include <fcntl.h>
 
+CFileDataSink::CFileDataSink(const std::string &filename, std::size_t capacity)
+    : CBufferedDataSink(open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644), true, capacity, false){
 
-CFileDataSink::CFileDataSink(const std::string &filename){
-    DFile.open(filename);
 }
-
-bool CFileDataSink::Put(const char &ch) noexcept{
-    DFile.put(ch);
-    return DFile.good();
-}
-
-bool CFileDataSink::Write(const std::vector<char> &buf) noexcept{
-    DFile.write(buf.data(),buf.size());
-    return DFile.good();
-}
\ No newline at end of file
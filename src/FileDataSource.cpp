@@ -1,44 +1,58 @@
 #include "FileDataSource.h"
+#include <algorithm>
 
-CFileDataSource::CFileDataSource(const std::string &filename){
-    DFile.open(filename);
-    if(DFile.good()){
-        DFile.peek();
+// size of the block read from the file at a time
+static const std::size_t FileBlockSize = 65536;
+
+CFileDataSource::CFileDataSource(const std::string &filename) : DIndex(0){
+    DFile.open(filename, std::ios::binary);
+    if(DFile.is_open()){
+        Fill();
     }
 }
 
+// refills the buffer once it has been used up, the buffer is only left
+// empty when the file has nothing more to give
+bool CFileDataSource::Fill(){
+    DIndex = 0;
+    DBuffer.resize(FileBlockSize);
+    DFile.read(DBuffer.data(), DBuffer.size());
+    DBuffer.resize(DFile.gcount());
+    return !DBuffer.empty();
+}
+
 bool CFileDataSource::End() const noexcept{
-    return DFile.eof();
+    return DIndex >= DBuffer.size() && DFile.eof();
 }
 
 bool CFileDataSource::Get(char &ch) noexcept{
-    if(!DFile.good()){
+    if(DIndex >= DBuffer.size()){
         return false;
     }
-    ch = DFile.get();
-    if(ch != EOF){
-        DFile.peek();
+    ch = DBuffer[DIndex++];
+    if(DIndex >= DBuffer.size() && DFile.good()){
+        Fill();
     }
-    return ch != EOF;
+    return true;
 }
 
 bool CFileDataSource::Peek(char &ch) noexcept{
-    if(!DFile.good()){
+    if(DIndex >= DBuffer.size()){
         return false;
     }
-    ch = DFile.peek();
-    return ch != EOF;
+    ch = DBuffer[DIndex];
+    return true;
 }
 
 bool CFileDataSource::Read(std::vector<char> &buf, std::size_t count) noexcept{
-    if(!DFile.good()){
-        return false;
-    }
-    char TempCh;
     buf.clear();
-    buf.reserve(count);
-    while(buf.size() < count && Get(TempCh)){
-        buf.push_back(TempCh);
+    while(buf.size() < count && DIndex < DBuffer.size()){
+        std::size_t Length = std::min(count - buf.size(), DBuffer.size() - DIndex);
+        buf.insert(buf.end(), DBuffer.begin() + DIndex, DBuffer.begin() + DIndex + Length);
+        DIndex += Length;
+        if(DIndex >= DBuffer.size() && DFile.good()){
+            Fill();
+        }
     }
     return !buf.empty();
 }
@@ -0,0 +1,77 @@
+#include "MemoryMappedDataSource.h"
+#include <algorithm>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+CMemoryMappedDataSource::CMemoryMappedDataSource(const std::string &filename) : DData(nullptr), DSize(0), DIndex(0){
+    int FileDescriptor = open(filename.c_str(), O_RDONLY);
+    if(FileDescriptor < 0){
+        return;
+    }
+    struct stat FileStatus;
+    if(fstat(FileDescriptor, &FileStatus) == 0 && S_ISREG(FileStatus.st_mode) && FileStatus.st_size > 0){
+        void *Mapping = mmap(nullptr, FileStatus.st_size, PROT_READ, MAP_SHARED, FileDescriptor, 0);
+        if(Mapping != MAP_FAILED){
+            // the file is read front to back, so let the kernel read ahead aggressively
+            madvise(Mapping, FileStatus.st_size, MADV_SEQUENTIAL);
+            DData = static_cast<const char *>(Mapping);
+            DSize = FileStatus.st_size;
+        }
+    }
+    // the mapping stays valid after the descriptor is closed
+    close(FileDescriptor);
+}
+
+CMemoryMappedDataSource::~CMemoryMappedDataSource(){
+    if(DData){
+        munmap(const_cast<char *>(DData), DSize);
+    }
+}
+
+bool CMemoryMappedDataSource::Valid() const noexcept{
+    return DData != nullptr;
+}
+
+bool CMemoryMappedDataSource::End() const noexcept{
+    return DIndex >= DSize;
+}
+
+bool CMemoryMappedDataSource::Get(char &ch) noexcept{
+    if(DIndex < DSize){
+        ch = DData[DIndex];
+        DIndex++;
+        return true;
+    }
+    return false;
+}
+
+bool CMemoryMappedDataSource::Peek(char &ch) noexcept{
+    if(DIndex < DSize){
+        ch = DData[DIndex];
+        return true;
+    }
+    return false;
+}
+
+bool CMemoryMappedDataSource::Read(std::vector<char> &buf, std::size_t count) noexcept{
+    const char *View;
+    std::size_t Length;
+    buf.clear();
+    if(!ReadView(View, Length, count)){
+        return false;
+    }
+    buf.assign(View, View + Length);
+    return true;
+}
+
+bool CMemoryMappedDataSource::ReadView(const char *&data, std::size_t &length, std::size_t count) noexcept{
+    length = std::min(count, DSize - DIndex);
+    if(!length){
+        return false;
+    }
+    data = DData + DIndex;
+    DIndex += length;
+    return true;
+}
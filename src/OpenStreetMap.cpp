@@ -1,72 +1,213 @@
 #include "OpenStreetMap.h"
 #include "XMLReader.h"
 #include "StreetMap.h"
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <cmath>
+#include <deque>
+#include <limits>
 #include <memory>
 #include <vector>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
 #include <unordered_map>
-#include <iostream>
-#include "DSVReader.h"
+#include <cstring>
 
 struct COpenStreetMap::SImplementation {
     // forward declaration of node and way implementation classes
-    class SNodeImpl;
+    struct SStringTable;
+    struct SNodeTable;
+    class SNodeView;
     class SWayImpl;
+    class SParseHandler;
     
-    // containers for nodes and ways
-    std::vector<std::shared_ptr<SNodeImpl>> Nodes;
+    using TStringID = uint32_t;
+    using TAttribute = std::pair<TStringID, TStringID>; // interned key and value
+
+    // containers for the tag strings, nodes and ways
+    std::shared_ptr<SStringTable> Strings;
+    std::shared_ptr<SNodeTable> Nodes;
     std::vector<std::shared_ptr<SWayImpl>> Ways;
+
+    // ID to index lookups built while parsing, the first occurrence of an ID wins
+    std::unordered_map<TNodeID, std::size_t> NodeIndices;
+    std::unordered_map<TWayID, std::size_t> WayIndices;
+
+    SImplementation();
+
+    // returns the view of the node at index, creating it if none is alive
+    std::shared_ptr<SNodeView> NodeView(std::size_t index) const;
+
+    // returns the attribute in [begin, end) with the key, or end if there is none
+    static const TAttribute *FindAttribute(const SStringTable &strings, const TAttribute *begin, const TAttribute *end, const std::string &key) noexcept;
+};
+
+// every distinct attribute key and value is stored once, elements refer to
+// them by index so lookups compare integers
+struct COpenStreetMap::SImplementation::SStringTable {
+    static constexpr TStringID NotFound = std::numeric_limits<TStringID>::max();
+
+    std::deque<std::string> Strings; // a deque never moves its strings, so the views below stay valid
+    std::unordered_map<std::string_view, TStringID> Indices; // index of each string
+
+    // returns the index of str, adding it if it is new
+    TStringID Intern(std::string_view str) {
+        auto search = Indices.find(str);
+        if (search != Indices.end()) {
+            return search->second;
+        }
+        Strings.emplace_back(str);
+        return Indices.emplace(Strings.back(), TStringID(Strings.size() - 1)).first->second;
+    }
+
+    // returns the index of str, or NotFound if no element uses it
+    TStringID Find(std::string_view str) const noexcept {
+        auto search = Indices.find(str);
+        return (search != Indices.end()) ? search->second : NotFound;
+    }
+};
+
+// nodes stored as parallel arrays so a node costs its ID and location, the
+// few nodes with attributes keep them in a side table
+struct COpenStreetMap::SImplementation::SNodeTable {
+    std::vector<TNodeID> IDs; // identifier of each node
+    std::vector<double> Latitudes; // latitude of each node
+    std::vector<double> Longitudes; // longitude of each node
+
+    // ascending indices of the nodes that have attributes, the attributes of
+    // the i-th one are Attributes[AttributeRows[i]] up to AttributeRows[i + 1]
+    std::vector<std::size_t> TaggedNodes;
+    std::vector<std::size_t> AttributeRows = {0};
+    std::vector<TAttribute> Attributes;
+    std::shared_ptr<const SStringTable> Strings; // strings the attributes refer to
+
+    // view of each node that someone still holds, so a node is handed out
+    // as the same object while it is held. The lowest bit locks the slot,
+    // a lookup and the destructor of a view only ever wait on one node.
+    std::vector<std::atomic<std::uintptr_t>> Views;
+
+    // locks the slot of the node at index, returns the view it points to
+    SNodeView *LockView(std::size_t index) {
+        auto value = Views[index].load(std::memory_order_relaxed);
+        while ((value & 1) || !Views[index].compare_exchange_weak(value, value | 1, std::memory_order_acquire, std::memory_order_relaxed)) {
+            if (value & 1) {
+                std::this_thread::yield();
+                value = Views[index].load(std::memory_order_relaxed);
+            }
+        }
+        return reinterpret_cast<SNodeView *>(value);
+    }
+
+    // points the locked slot of the node at index to view and unlocks it
+    void UnlockView(std::size_t index, SNodeView *view) {
+        Views[index].store(reinterpret_cast<std::uintptr_t>(view), std::memory_order_release);
+    }
 };
 
-// node implementation, inheriting from CStreetMap::SNode
-class COpenStreetMap::SImplementation::SNodeImpl : public CStreetMap::SNode {
+// node handed out by the map, reads the table of the map it came from
+class COpenStreetMap::SImplementation::SNodeView : public CStreetMap::SNode, public std::enable_shared_from_this<SNodeView> {
 public:
-    TNodeID NodeID; // node identifier
-    TLocation NodeLocation; // coordinates (latitude, longitude)
-    std::unordered_map<std::string, std::string> Attributes; // additional attributes
+    std::shared_ptr<SNodeTable> Table; // keeps the table alive after the map is gone
+    std::size_t Index; // index of the node in the table
+    std::size_t AttributeBegin = 0; // first attribute of the node in the table
+    std::size_t AttributeEnd = 0; // one past the last attribute of the node
+
+    SNodeView(std::shared_ptr<SNodeTable> table, std::size_t index) : Table(std::move(table)), Index(index) {
+        auto tagged = std::lower_bound(Table->TaggedNodes.begin(), Table->TaggedNodes.end(), index);
+        if (tagged != Table->TaggedNodes.end() && *tagged == index) { // look up the attributes of the node
+            AttributeBegin = Table->AttributeRows[tagged - Table->TaggedNodes.begin()];
+            AttributeEnd = Table->AttributeRows[tagged - Table->TaggedNodes.begin() + 1];
+        }
+    }
+
+    ~SNodeView() override {
+        // forget the view unless a newer one already took its place
+        auto view = Table->LockView(Index);
+        Table->UnlockView(Index, view == this ? nullptr : view);
+    }
 
     TNodeID ID() const noexcept override { // override the ID method
-        return NodeID; // return the node identifier
+        return Table->IDs[Index]; // return the node identifier
     }
 
     // override the Location method
     TLocation Location() const noexcept override {
-        return NodeLocation; // return the node location
+        return {Table->Latitudes[Index], Table->Longitudes[Index]}; // return the node location
     }
 
     // override the AttributeCount method
     std::size_t AttributeCount() const noexcept override {
-        return Attributes.size(); // return the number of attributes
+        return AttributeEnd - AttributeBegin; // return the number of attributes
     }
 
     // override the GetAttributeKey method
     std::string GetAttributeKey(std::size_t index) const noexcept override {
-        if (index < Attributes.size()) { // check if the index is within bounds
-            auto it = Attributes.begin(); // get an iterator to the beginning of the map
-            std::advance(it, index); // advance the iterator by the index
-            return it->first; // return the key at the specified index
+        if (index < AttributeCount()) { // check if the index is within bounds
+            return Table->Strings->Strings[Table->Attributes[AttributeBegin + index].first]; // return the key at the specified index
         }
         return "";
     }
 
     // override the HasAttribute method
     bool HasAttribute(const std::string &key) const noexcept override {
-        return Attributes.find(key) != Attributes.end(); // check if the key exists in the map
+        return Find(key) != End(); // check if the key exists
     }
 
     // override the GetAttribute method
     std::string GetAttribute(const std::string &key) const noexcept override {
-        auto it = Attributes.find(key); // find the key in the map
-        return (it != Attributes.end()) ? it->second : ""; // return the value if found, otherwise an empty string
+        auto attribute = Find(key); // find the key in the table
+        return (attribute != End()) ? Table->Strings->Strings[attribute->second] : ""; // return the value if found, otherwise an empty string
+    }
+
+private:
+    const TAttribute *End() const noexcept {
+        return Table->Attributes.data() + AttributeEnd;
+    }
+
+    const TAttribute *Find(const std::string &key) const noexcept {
+        return FindAttribute(*Table->Strings, Table->Attributes.data() + AttributeBegin, End(), key);
     }
 };
 
+COpenStreetMap::SImplementation::SImplementation()
+    : Strings(std::make_shared<SStringTable>()), Nodes(std::make_shared<SNodeTable>()) {
+    Nodes->Strings = Strings;
+}
+
+const COpenStreetMap::SImplementation::TAttribute *COpenStreetMap::SImplementation::FindAttribute(const SStringTable &strings, const TAttribute *begin, const TAttribute *end, const std::string &key) noexcept {
+    auto keyID = strings.Find(key); // a key no element uses cannot match
+    if (keyID != SStringTable::NotFound) {
+        for (; begin != end; ++begin) {
+            if (begin->first == keyID) {
+                return begin;
+            }
+        }
+    }
+    return end;
+}
+
+std::shared_ptr<COpenStreetMap::SImplementation::SNodeView> COpenStreetMap::SImplementation::NodeView(std::size_t index) const {
+    // a view in the slot cannot be freed while the slot is locked, but it
+    // may already be on its way out, then a new one takes its place
+    SNodeView *view = Nodes->LockView(index);
+    std::shared_ptr<SNodeView> result = view ? view->weak_from_this().lock() : nullptr;
+    if (!result) {
+        result = std::make_shared<SNodeView>(Nodes, index);
+    }
+    Nodes->UnlockView(index, result.get());
+    return result;
+}
+
 // way implementation, inheriting from CStreetMap::SWay
 class COpenStreetMap::SImplementation::SWayImpl : public CStreetMap::SWay {
 public:
     TWayID WayID; // way identifier
     std::vector<TNodeID> NodeIDs; // list of node IDs forming the way
-    std::unordered_map<std::string, std::string> Attributes; // way attributes
+    std::vector<TAttribute> Attributes; // way attributes
+    std::shared_ptr<const SStringTable> Strings; // strings the attributes refer to
 
     TWayID ID() const noexcept override { // override the ID method
         return WayID; // return the way identifier
@@ -90,103 +231,260 @@ public:
     // override the GetAttributeKey method
     std::string GetAttributeKey(std::size_t index) const noexcept override {
         if (index < Attributes.size()) {
-            auto it = Attributes.begin(); // get an iterator to the beginning of the map
-            std::advance(it, index); // advance the iterator by the index
-            return it->first; // return the key at the specified index
+            return Strings->Strings[Attributes[index].first]; // return the key at the specified index
         }
         return "";
     }
 
     // override the HasAttribute method
     bool HasAttribute(const std::string &key) const noexcept override {
-        return Attributes.find(key) != Attributes.end(); // check if the key exists in the map
+        return Find(key) != Attributes.data() + Attributes.size(); // check if the key exists
     }
 
     // override the GetAttribute method
     std::string GetAttribute(const std::string &key) const noexcept override {
-        auto it = Attributes.find(key); // find the key in the map
-        return (it != Attributes.end()) ? it->second : ""; // return the value if found, otherwise an empty string
+        auto attribute = Find(key); // find the key
+        return (attribute != Attributes.data() + Attributes.size()) ? Strings->Strings[attribute->second] : ""; // return the value if found, otherwise an empty string
+    }
+
+private:
+    const TAttribute *Find(const std::string &key) const noexcept {
+        return FindAttribute(*Strings, Attributes.data(), Attributes.data() + Attributes.size(), key);
     }
 };
 
-// constructor parses XML and populates nodes and ways
-COpenStreetMap::COpenStreetMap(std::shared_ptr<CXMLReader> src) {
-    DImplementation = std::make_unique<SImplementation>(); // create the implementation object
-    SXMLEntity entity; // create an entity object to store XML data
-    std::shared_ptr<SImplementation::SNodeImpl> currentNode = nullptr; // create a pointer to the current node
-    std::shared_ptr<SImplementation::SWayImpl> currentWay = nullptr; // create a pointer to the current way
-    
-    // process XML entities from the provided source
-    while (src->ReadEntity(entity)) {
-        if (entity.DType == SXMLEntity::EType::StartElement) { // check if the entity is a start element
-            if (entity.DNameData == "node") { // check if the element is a node
-                currentNode = std::make_shared<SImplementation::SNodeImpl>(); // create a new node
-                currentWay.reset(); // reset the current way pointer
-                // process node attributes
-                for (const auto &attr : entity.DAttributes) { // iterate through the attributes
-                    if (attr.first == "id") { // check if the attribute is the node ID
-                        currentNode->NodeID = std::stoull(attr.second); // set the node ID
-                    } else if (attr.first == "lat") { // check if the attribute is the latitude
-                        currentNode->NodeLocation.first = std::stod(attr.second); // set the latitude
-                    } else if (attr.first == "lon") { // check if the attribute is the longitude
-                        currentNode->NodeLocation.second = std::stod(attr.second); // set the longitude
-                    } else { // if the attribute is not the node ID, latitude, or longitude
-                        currentNode->Attributes[attr.first] = attr.second; // add the attribute to the node
-                    }
+// builds nodes and ways straight from parser events, no entities are created
+class COpenStreetMap::SImplementation::SParseHandler : public CXMLHandler {
+public:
+    SImplementation &Map; // map being filled
+    bool InNode = false; // true while a node element is open
+    bool NodeValid = false; // false once an ID or coordinate of the open node fails to parse
+    TNodeID NodeID = 0; // identifier of the open node
+    TLocation NodeLocation; // location of the open node
+    bool InWay = false; // true while a way element is open
+    bool WayKept = false; // true once the open way passes the way filter
+    bool WayValid = false; // false once the ID or a node reference of the open way fails to parse
+    TWayID WayID = 0; // identifier of the open way
+    std::vector<TNodeID> WayNodeIDs; // nodes of the open way
+    // attributes of the open way, kept as text until the way is known to be
+    // kept, only the first WayAttributeCount entries are in use
+    std::vector<std::pair<std::string, std::string>> WayAttributes;
+    std::size_t WayAttributeCount = 0;
+    const SLoadFilter &Filter; // what to keep
+
+    SParseHandler(SImplementation &map, const SLoadFilter &filter) : Map(map), Filter(filter) {}
+
+    // parses str straight from the parser's text, unlike strtod it ignores
+    // the locale. A leading + is allowed, anything else that is not part of
+    // the number, a sign on an unsigned ID, a value out of range or a
+    // coordinate that is not finite fails.
+    template <typename T>
+    static bool ParseNumber(const char *str, T &value) {
+        if (str[0] == '+' && str[1] != '-') {
+            str++;
+        }
+        const char *end = str + std::strlen(str);
+        auto result = std::from_chars(str, end, value);
+        if constexpr (std::is_floating_point<T>::value) {
+            if (!std::isfinite(value)) {
+                return false;
+            }
+        }
+        return result.ec == std::errc() && result.ptr == end;
+    }
+
+    // true if key is in keys, an empty list holds every key
+    static bool Listed(const std::vector<std::string> &keys, const char *key) {
+        if (keys.empty()) {
+            return true;
+        }
+        for (const auto &listed : keys) {
+            if (listed == key) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // drops the attributes of a node that was never closed
+    void DiscardNode() {
+        auto &table = *Map.Nodes;
+        table.Attributes.erase(table.Attributes.begin() + table.AttributeRows.back(), table.Attributes.end());
+        InNode = false;
+    }
+
+    // sets an attribute in [begin, attributes.end()), a repeated key replaces the value
+    void SetAttribute(std::vector<TAttribute> &attributes, std::size_t begin, const char *key, const char *value) {
+        TAttribute attribute(Map.Strings->Intern(key), Map.Strings->Intern(value));
+        for (auto index = begin; index < attributes.size(); index++) {
+            if (attributes[index].first == attribute.first) {
+                attributes[index].second = attribute.second;
+                return;
+            }
+        }
+        attributes.push_back(attribute);
+    }
+
+    void SetNodeAttribute(const char *key, const char *value) {
+        if (Listed(Filter.DAttributeKeys, key)) {
+            SetAttribute(Map.Nodes->Attributes, Map.Nodes->AttributeRows.back(), key, value);
+        }
+    }
+
+    void SetWayAttribute(const char *key, const char *value) {
+        if (!WayKept && Listed(Filter.DWayKeys, key)) {
+            WayKept = true;
+        }
+        if (!Listed(Filter.DAttributeKeys, key)) {
+            return;
+        }
+        for (std::size_t index = 0; index < WayAttributeCount; index++) {
+            if (WayAttributes[index].first == key) {
+                WayAttributes[index].second = value;
+                return;
+            }
+        }
+        if (WayAttributeCount == WayAttributes.size()) {
+            WayAttributes.emplace_back();
+        }
+        // assigning reuses the buffers of earlier ways
+        WayAttributes[WayAttributeCount].first = key;
+        WayAttributes[WayAttributeCount].second = value;
+        WayAttributeCount++;
+    }
+
+    void StartElement(const char *name, const char **attributes) override {
+        if (std::strcmp(name, "node") == 0) { // check if the element is a node
+            DiscardNode(); // drop any node that was never closed
+            InNode = true;
+            NodeValid = true;
+            NodeID = 0;
+            NodeLocation = {0.0, 0.0};
+            InWay = false; // drop any open way
+            // process node attributes
+            for (int i = 0; attributes[i]; i += 2) {
+                if (std::strcmp(attributes[i], "id") == 0) { // check if the attribute is the node ID
+                    NodeValid = ParseNumber(attributes[i + 1], NodeID) && NodeValid; // set the node ID
+                } else if (std::strcmp(attributes[i], "lat") == 0) { // check if the attribute is the latitude
+                    NodeValid = ParseNumber(attributes[i + 1], NodeLocation.first) && NodeValid; // set the latitude
+                } else if (std::strcmp(attributes[i], "lon") == 0) { // check if the attribute is the longitude
+                    NodeValid = ParseNumber(attributes[i + 1], NodeLocation.second) && NodeValid; // set the longitude
+                } else { // if the attribute is not the node ID, latitude, or longitude
+                    SetNodeAttribute(attributes[i], attributes[i + 1]); // add the attribute to the node
                 }
-            } else if (entity.DNameData == "way") { // check if the element is a way
-                currentWay = std::make_shared<SImplementation::SWayImpl>(); // create a new way
-                currentNode.reset(); // reset the current node pointer
-                // process way attributes
-                for (const auto &attr : entity.DAttributes) { // iterate through the attributes
-                    if (attr.first == "id") { // check if the attribute is the way ID
-                        currentWay->WayID = std::stoull(attr.second); // set the way ID
-                    } else {
-                        currentWay->Attributes[attr.first] = attr.second; // add the attribute to the way
-                    }
+            }
+        } else if (std::strcmp(name, "way") == 0) { // check if the element is a way
+            InWay = true; // start a new way
+            WayKept = Filter.DWayKeys.empty();
+            WayValid = true;
+            WayID = 0;
+            WayNodeIDs.clear();
+            WayAttributeCount = 0;
+            DiscardNode(); // drop any open node
+            // process way attributes
+            for (int i = 0; attributes[i]; i += 2) {
+                if (std::strcmp(attributes[i], "id") == 0) { // check if the attribute is the way ID
+                    WayValid = ParseNumber(attributes[i + 1], WayID) && WayValid; // set the way ID
+                } else {
+                    SetWayAttribute(attributes[i], attributes[i + 1]); // add the attribute to the way
                 }
-            } else if (entity.DNameData == "nd" && currentWay) { // check if the element is a node reference inside a way
-                // process node reference inside a way
-                for (const auto &attr : entity.DAttributes) { // iterate through the attributes
-                    if (attr.first == "ref") { // check if the attribute is the node reference
-                        currentWay->NodeIDs.push_back(std::stoull(attr.second)); // add the node reference to the way
-                    }
+            }
+        } else if (std::strcmp(name, "nd") == 0 && InWay) { // check if the element is a node reference inside a way
+            for (int i = 0; attributes[i]; i += 2) {
+                if (std::strcmp(attributes[i], "ref") == 0) { // check if the attribute is the node reference
+                    TNodeID nodeID = 0;
+                    WayValid = ParseNumber(attributes[i + 1], nodeID) && WayValid;
+                    WayNodeIDs.push_back(nodeID); // add the node reference to the way
                 }
-            } else if (entity.DNameData == "tag") {
-                // process tag elements for both nodes and ways.
-                std::string key, value;
-                for (const auto &attr : entity.DAttributes) { // iterate through the attributes
-                    if (attr.first == "k") { // check if the attribute is the key
-                        key = attr.second; // set the key
-                    } else if (attr.first == "v") { // check if the attribute is the value
-                        value = attr.second; // set the value
-                    }
+            }
+        } else if (std::strcmp(name, "tag") == 0) {
+            // process tag elements for both nodes and ways, the last k and v win
+            const char *key = nullptr;
+            const char *value = "";
+            for (int i = 0; attributes[i]; i += 2) {
+                if (std::strcmp(attributes[i], "k") == 0) { // check if the attribute is the key
+                    key = attributes[i + 1];
+                } else if (std::strcmp(attributes[i], "v") == 0) { // check if the attribute is the value
+                    value = attributes[i + 1];
                 }
-                // add the key-value pair to the node or way attributes
-                if (!key.empty()) {
-                    if (currentNode) {
-                        currentNode->Attributes[key] = value; // add the attribute to the node
-                    } else if (currentWay) {
-                        currentWay->Attributes[key] = value; // add the attribute to the way
-                    }
+            }
+            // add the key-value pair to the node or way attributes
+            if (key && *key) {
+                if (InNode) {
+                    SetNodeAttribute(key, value); // add the attribute to the node
+                } else if (InWay) {
+                    SetWayAttribute(key, value); // add the attribute to the way
                 }
             }
-        } else if (entity.DType == SXMLEntity::EType::EndElement) { // check if the entity is an end element
-            if (entity.DNameData == "node" && currentNode) { // check if the element is a node and the current node is valid
-                DImplementation->Nodes.push_back(currentNode); // add the current node to the list of nodes
-                currentNode.reset(); // reset the current node pointer
-            } else if (entity.DNameData == "way" && currentWay) { // check if the element is a way and the current way is valid
-                DImplementation->Ways.push_back(currentWay); // add the current way to the list of ways
-                currentWay.reset(); // reset the current way pointer
+        }
+    }
+
+    void EndElement(const char *name) override {
+        if (InNode && std::strcmp(name, "node") == 0) { // check if the element is a node and the current node is valid
+            if (!NodeValid) { // a node whose ID or location did not parse is dropped
+                DiscardNode();
+                return;
+            }
+            auto &table = *Map.Nodes;
+            Map.NodeIndices.emplace(NodeID, table.IDs.size()); // index the node by its ID
+            if (table.Attributes.size() > table.AttributeRows.back()) { // record the attributes of the node
+                table.TaggedNodes.push_back(table.IDs.size());
+                table.AttributeRows.push_back(table.Attributes.size());
+            }
+            table.IDs.push_back(NodeID); // add the node to the table
+            table.Latitudes.push_back(NodeLocation.first);
+            table.Longitudes.push_back(NodeLocation.second);
+            InNode = false;
+        } else if (InWay && std::strcmp(name, "way") == 0) { // check if the element is a way and the current way is valid
+            InWay = false;
+            if (!WayKept || !WayValid) { // ways the filter rejects or that did not parse are never built
+                return;
+            }
+            auto way = std::make_shared<SWayImpl>(); // create the way
+            way->WayID = WayID;
+            way->NodeIDs = WayNodeIDs;
+            way->Strings = Map.Strings;
+            way->Attributes.reserve(WayAttributeCount);
+            for (std::size_t index = 0; index < WayAttributeCount; index++) {
+                way->Attributes.emplace_back(Map.Strings->Intern(WayAttributes[index].first), Map.Strings->Intern(WayAttributes[index].second));
             }
+            Map.WayIndices.emplace(WayID, Map.Ways.size()); // index the way by its ID
+            Map.Ways.push_back(std::move(way)); // add the way to the list of ways
         }
     }
+};
+
+// constructor parses XML and populates nodes and ways
+COpenStreetMap::COpenStreetMap(std::shared_ptr<CXMLReader> src, const SLoadFilter &filter) {
+    DImplementation = std::make_unique<SImplementation>(); // create the implementation object
+    SImplementation::SParseHandler handler(*DImplementation, filter);
+    // a malformed document keeps everything completed before the error
+    src->Parse(handler);
+    handler.DiscardNode();
+    auto &table = *DImplementation->Nodes; // release the spare capacity of the node arrays
+    table.IDs.shrink_to_fit();
+    table.Latitudes.shrink_to_fit();
+    table.Longitudes.shrink_to_fit();
+    table.Views = std::vector<std::atomic<std::uintptr_t>>(table.IDs.size());
+}
+
+// constructor that reads the XML document straight from a data source
+COpenStreetMap::COpenStreetMap(std::shared_ptr<CDataSource> src, const SLoadFilter &filter)
+    : COpenStreetMap(std::make_shared<CXMLReader>(std::move(src)), filter) {}
+
+// keeps the ways a planner can route on and the attributes it reads
+COpenStreetMap::SLoadFilter COpenStreetMap::SLoadFilter::Routing() {
+    SLoadFilter filter;
+    filter.DWayKeys = {"highway"};
+    filter.DAttributeKeys = {"highway", "oneway", "maxspeed", "name", "junction",
+                             "access", "foot", "bicycle", "motor_vehicle", "bus"};
+    return filter;
 }
 
 COpenStreetMap::~COpenStreetMap() = default; // default destructor
 
 std::size_t COpenStreetMap::NodeCount() const noexcept { // override the NodeCount method
-    return DImplementation->Nodes.size(); // return the number of nodes
+    return DImplementation->Nodes->IDs.size(); // return the number of nodes
 }
 
 std::size_t COpenStreetMap::WayCount() const noexcept { // override the WayCount method
@@ -194,18 +492,17 @@ std::size_t COpenStreetMap::WayCount() const noexcept { // override the WayCount
 }
 
 std::shared_ptr<CStreetMap::SNode> COpenStreetMap::NodeByIndex(std::size_t index) const noexcept { // override the NodeByIndex method
-    if (index < DImplementation->Nodes.size()) { // check if the index is within bounds
-        return DImplementation->Nodes[index]; // return the node at the specified inswz
+    if (index < DImplementation->Nodes->IDs.size()) { // check if the index is within bounds
+        return DImplementation->NodeView(index); // return the node at the specified index
     }
     return nullptr;
 }
 
 // override the NodeByID method
 std::shared_ptr<CStreetMap::SNode> COpenStreetMap::NodeByID(TNodeID id) const noexcept {
-    for (const auto &node : DImplementation->Nodes) { // iterate through the nodes
-        if (node->ID() == id) { // check if the node ID matches the specified ID
-            return node; // return the node if found
-        }
+    auto search = DImplementation->NodeIndices.find(id); // look up the index of the node
+    if (search != DImplementation->NodeIndices.end()) {
+        return DImplementation->NodeView(search->second); // return the node if found
     }
     return nullptr;
 }
@@ -220,10 +517,9 @@ std::shared_ptr<CStreetMap::SWay> COpenStreetMap::WayByIndex(std::size_t index)
 
 // override the WayByID method
 std::shared_ptr<CStreetMap::SWay> COpenStreetMap::WayByID(TWayID id) const noexcept {
-    for (const auto &way : DImplementation->Ways) {
-        if (way->ID() == id) { // check if the way ID matches the specified ID
-            return way; // return the way if found
-        }
+    auto search = DImplementation->WayIndices.find(id); // look up the index of the way
+    if (search != DImplementation->WayIndices.end()) {
+        return DImplementation->Ways[search->second]; // return the way if found
     }
     return nullptr;
 }
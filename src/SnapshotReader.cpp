@@ -0,0 +1,109 @@
+#include "SnapshotReader.h"
+#include "SnapshotWriter.h"
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// implementation structure for CSnapshotReader, holds the mapping
+struct CSnapshotReader::SImplementation {
+    // start of the mapped file, nullptr if it could not be mapped
+    const char *Data = nullptr;
+    // size of the mapped file
+    std::size_t Size = 0;
+    // offset of the next read
+    std::size_t Offset = 0;
+    // version from the header
+    uint32_t Version = 0;
+    // false once a read has run past the end
+    bool Good = false;
+
+    SImplementation(const std::string &filename) {
+        int FileDescriptor = open(filename.c_str(), O_RDONLY);
+        if (FileDescriptor < 0) {
+            return; }
+        struct stat FileStatus;
+        if (fstat(FileDescriptor, &FileStatus) == 0 && FileStatus.st_size > 0) {
+            void *Mapping = mmap(nullptr, FileStatus.st_size, PROT_READ, MAP_SHARED, FileDescriptor, 0);
+            if (Mapping != MAP_FAILED) {
+                Data = static_cast<const char *>(Mapping);
+                Size = FileStatus.st_size;
+                Good = true;
+            }
+        }
+        //the mapping stays valid after the descriptor is closed
+        close(FileDescriptor);
+    }
+
+    ~SImplementation() {
+        if (Data) {
+            munmap(const_cast<char *>(Data), Size); }
+    }
+
+    bool ReadBytes(void *data, std::size_t size) {
+        if (!Good || size > Size - Offset) {
+            Good = false;
+            return false;
+        }
+        if (size) { //an empty array has no storage to copy into
+            std::memcpy(data, Data + Offset, size); }
+        Offset += size;
+        return true;
+    }
+
+    bool Align() {
+        std::size_t Padding = (8 - Offset % 8) % 8;
+        if (!Good || Padding > Size - Offset) {
+            Good = false;
+            return false;
+        }
+        Offset += Padding;
+        return true;
+    }
+};
+
+// constructor for CSnapshotReader, maps the file and checks the header
+CSnapshotReader::CSnapshotReader(const std::string &filename)
+    : DImplementation(std::make_unique<SImplementation>(filename)) {
+    uint32_t Magic;
+    if (!ReadValue(Magic) || Magic != CSnapshotWriter::Magic || !ReadValue(DImplementation->Version)) {
+        DImplementation->Good = false;
+    }
+}
+
+// destructor unmaps the file
+CSnapshotReader::~CSnapshotReader() = default;
+
+// returns true if the file was mapped and no read has failed
+bool CSnapshotReader::Valid() const {
+    return DImplementation->Good;
+}
+
+// returns the version the snapshot was written with
+uint32_t CSnapshotReader::Version() const {
+    return DImplementation->Version;
+}
+
+bool CSnapshotReader::ReadBytes(void *data, std::size_t size) {
+    return DImplementation->ReadBytes(data, size);
+}
+
+bool CSnapshotReader::Align() {
+    return DImplementation->Align();
+}
+
+std::size_t CSnapshotReader::Remaining() const {
+    return DImplementation->Size - DImplementation->Offset;
+}
+
+// reads a string written by CSnapshotWriter::WriteString
+bool CSnapshotReader::ReadString(std::string &str) {
+    uint64_t Length;
+    if (!ReadValue(Length) || Length > Remaining()) {
+        DImplementation->Good = false;
+        return false;
+    }
+    str.resize(Length);
+    return ReadBytes(str.data(), Length);
+}
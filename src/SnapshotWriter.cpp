@@ -0,0 +1,75 @@
+#include "SnapshotWriter.h"
+#include <cstring>
+
+// implementation structure for CSnapshotWriter, writes are gathered in a
+// buffer so the many small values do not each go to the sink
+struct CSnapshotWriter::SImplementation {
+    // largest amount held before the buffer is written to the sink
+    static const std::size_t BufferSize = 1 << 16;
+    // data sink for writing
+    std::shared_ptr<CDataSink> Sink;
+    // bytes not yet written to the sink
+    std::vector<char> Buffer;
+    // total bytes written, used to align arrays
+    std::size_t Offset = 0;
+    // false once any write has failed
+    bool Good;
+
+    SImplementation(std::shared_ptr<CDataSink> sink)
+        : Sink(std::move(sink)), Good(Sink != nullptr) {
+        Buffer.reserve(BufferSize);
+    }
+
+    bool WriteBytes(const void *data, std::size_t size) {
+        if (!Good) {
+            return false; }
+        auto Bytes = static_cast<const char *>(data);
+        Buffer.insert(Buffer.end(), Bytes, Bytes + size);
+        Offset += size;
+        return Buffer.size() < BufferSize || Flush();
+    }
+
+    bool Align() {
+        static const char Padding[8] = {0};
+        return WriteBytes(Padding, (8 - Offset % 8) % 8);
+    }
+
+    bool Flush() {
+        if (Good && !Buffer.empty()) {
+            Good = Sink->Write(Buffer);
+            Buffer.clear();
+        }
+        return Good;
+    }
+};
+
+// constructor for CSnapshotWriter, writes the header with the version
+CSnapshotWriter::CSnapshotWriter(std::shared_ptr<CDataSink> sink, uint32_t version)
+    : DImplementation(std::make_unique<SImplementation>(std::move(sink))) {
+    WriteValue(Magic);
+    WriteValue(version);
+}
+
+// destructor writes anything still buffered
+CSnapshotWriter::~CSnapshotWriter() {
+    DImplementation->Flush();
+}
+
+bool CSnapshotWriter::WriteBytes(const void *data, std::size_t size) {
+    return DImplementation->WriteBytes(data, size);
+}
+
+bool CSnapshotWriter::Align() {
+    return DImplementation->Align();
+}
+
+// writes the length followed by the characters
+bool CSnapshotWriter::WriteString(const std::string &str) {
+    return WriteValue(uint64_t(str.size())) && WriteBytes(str.data(), str.size());
+}
+
+// writes anything still buffered through to the sink's destination, returns
+// false if any write failed
+bool CSnapshotWriter::Flush() {
+    return DImplementation->Flush() && DImplementation->Sink->Flush();
+}
@@ -1,12 +1,7 @@
 #include "StandardDataSink.h"
-#include <iostream>
+#include <unistd.h>
 
-bool CStandardDataSink::Put(const char &ch) noexcept{
-    std::cout.put(ch);
-    return std::cout.good();
-}
+CStandardDataSink::CStandardDataSink(std::size_t capacity)
+    : CBufferedDataSink(STDOUT_FILENO, false, capacity, isatty(STDOUT_FILENO)){
 
-bool CStandardDataSink::Write(const std::vector<char> &buf) noexcept{
-    std::cout.write(buf.data(),buf.size());
-    return std::cout.good();
-}
\ No newline at end of file
+}
@@ -1,38 +1,60 @@
 #include "StandardDataSource.h"
-#include <iostream>
+#include <algorithm>
+#include <cerrno>
+#include <unistd.h>
+
+// largest block taken from standard input at a time
+static const std::size_t StandardBlockSize = 65536;
+
+// reads whatever standard input has ready, a terminal hands over a line at a
+// time so nothing waits on input that has not been typed yet
+bool CStandardDataSource::Fill() noexcept{
+    if(DIndex < DBuffer.size()){
+        return true;
+    }
+    DIndex = 0;
+    DBuffer.resize(StandardBlockSize);
+    while(!DEnded){
+        ssize_t Length = read(STDIN_FILENO, DBuffer.data(), DBuffer.size());
+        if(Length > 0){
+            DBuffer.resize(Length);
+            return true;
+        }
+        if(Length == 0 || errno != EINTR){
+            DEnded = true;
+        }
+    }
+    DBuffer.clear();
+    return false;
+}
 
 bool CStandardDataSource::End() const noexcept{
-    return std::cin.eof();
+    return DEnded && DIndex >= DBuffer.size();
 }
 
 bool CStandardDataSource::Get(char &ch) noexcept{
-    if(!std::cin.good()){
+    if(!Fill()){
         return false;
     }
-    ch = std::cin.get();
-    if((ch != EOF)&&(ch != '\n')){
-        std::cin.peek();
-    }
-    return ch != EOF;
+    ch = DBuffer[DIndex++];
+    return true;
 }
 
 bool CStandardDataSource::Peek(char &ch) noexcept{
-    if(!std::cin.good()){
+    if(!Fill()){
         return false;
     }
-    ch = std::cin.peek();
-    return ch != EOF;
+    ch = DBuffer[DIndex];
+    return true;
 }
 
 bool CStandardDataSource::Read(std::vector<char> &buf, std::size_t count) noexcept{
-    if(!std::cin.good()){
-        return false;
-    }
-    char TempCh;
     buf.clear();
-    buf.reserve(count);
-    while(buf.size() < count && Get(TempCh)){
-        buf.push_back(TempCh);
+    if(!count || !Fill()){
+        return false;
     }
-    return !buf.empty();
+    std::size_t Length = std::min(count, DBuffer.size() - DIndex);
+    buf.assign(DBuffer.begin() + DIndex, DBuffer.begin() + DIndex + Length);
+    DIndex += Length;
+    return true;
 }
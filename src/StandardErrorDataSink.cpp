@@ -1,12 +1,7 @@
 #include "StandardErrorDataSink.h"
-#include <iostream>
+#include <unistd.h>
 
-bool CStandardErrorDataSink::Put(const char &ch) noexcept{
-    std::cerr.put(ch);
-    return std::cerr.good();
-}
+CStandardErrorDataSink::CStandardErrorDataSink(std::size_t capacity)
+    : CBufferedDataSink(STDERR_FILENO, false, capacity, true){
 
-bool CStandardErrorDataSink::Write(const std::vector<char> &buf) noexcept{
-    std::cerr.write(buf.data(),buf.size());
-    return std::cerr.good();
-}
\ No newline at end of file
+}
@@ -1,4 +1,5 @@
 #include "StringDataSource.h"
+#include <algorithm>
 
 CStringDataSource::CStringDataSource(const std::string &str) : DString(str), DIndex(0){
 
@@ -27,14 +28,10 @@ bool CStringDataSource::Peek(char &ch) noexcept{
 
 bool CStringDataSource::Read(std::vector<char> &buf, std::size_t count) noexcept{
     buf.clear();
-    while(buf.size() < count){
-        char TempChar;
-        if(Get(TempChar)){
-            buf.push_back(TempChar);
-        }
-        else{
-            break;
-        }
+    if(DIndex < DString.length()){
+        std::size_t Length = std::min(count, DString.length() - DIndex);
+        buf.assign(DString.begin() + DIndex, DString.begin() + DIndex + Length);
+        DIndex += Length;
     }
     return !buf.empty();
 }
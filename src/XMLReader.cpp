@@ -1,4 +1,5 @@
 #include "XMLReader.h"
+#include "MemoryMappedDataSource.h"
 #include <expat.h>
 #include <queue>
 #include <memory>
@@ -10,10 +11,25 @@ struct CXMLReader::SImplementation {
     std::queue<SXMLEntity> Queue; // queue to hold parsed XML entities
     bool Data; // flag to check if data parsing is complete
     std::string Buffer; // buffer to accumulate text data between XML tags
+    CXMLHandler *Handler = nullptr; // receives events directly while Parse runs
+    std::shared_ptr<CMemoryMappedDataSource> MappedSource; // source as a mapping, if it is one
+    std::vector<char> Block; // block copied out of sources that cannot be mapped
+
+    // number of bytes handed to Expat per call by ReadEntity and Parse
+    static constexpr std::size_t EntityBlockSize = 4096;
+    static constexpr std::size_t ParseBlockSize = std::size_t(1) << 24;
 
     // handles both start and end element events in one unified function
     static void ElementHandler(void *userData, const char *name, const char **element, bool isStart) {
         auto *impl = static_cast<SImplementation *>(userData);
+        if (impl->Handler) {
+            if (isStart) {
+                impl->Handler->StartElement(name, element);
+            } else {
+                impl->Handler->EndElement(name);
+            }
+            return;
+        }
         impl->FlushCharData();  // flush out any accumulated character data
 
         SXMLEntity entity;
@@ -44,13 +60,19 @@ struct CXMLReader::SImplementation {
 
     // processes character data found within XML elements
     static void CharDataHandler(void *userData, const char *j, int len) {
+        auto *impl = static_cast<SImplementation *>(userData);
         if (j && len > 0) {
-            static_cast<SImplementation *>(userData)->Buffer.append(j, len);  // Append text to the buffer.
+            if (impl->Handler) {
+                impl->Handler->CharData(j, len);
+            } else {
+                impl->Buffer.append(j, len);  // Append text to the buffer.
+            }
         }
     }
 
     // constructor sets up the parser and registers handlers for parsing events
     SImplementation(std::shared_ptr<CDataSource> src) : Source(std::move(src)), Data(false) {
+        MappedSource = std::dynamic_pointer_cast<CMemoryMappedDataSource>(Source);
         Parser = XML_ParserCreate(nullptr);
         XML_SetUserData(Parser, this);
         XML_SetElementHandler(Parser, StartElementHandler, EndElementHandler);
@@ -70,27 +92,32 @@ struct CXMLReader::SImplementation {
         }
     }
 
+    // points data at the next block of at most count bytes, a mapped source
+    // hands out its own memory and any other source is copied into Block
+    bool NextBlock(const char *&data, std::size_t &length, std::size_t count) {
+        if (MappedSource) {
+            return MappedSource->ReadView(data, length, count);
+        }
+        if (Source->End() || !Source->Read(Block, count)) {
+            return false;
+        }
+        data = Block.data();
+        length = Block.size();
+        return true;
+    }
+
     // reads and parses XML data from the source, processing entities into the queue
     bool ReadEntity(SXMLEntity &entity, bool skipcdata) {
         while (Queue.empty() && !Data) {
-            std::vector<char> buffer(4096);
-            size_t length = 0;
-            while (length < buffer.size() && !Source->End()) {
-                char ch;
-                if (Source->Get(ch)) {
-                    buffer[length++] = ch;  // fill buffer with data from the source
-                } else {
-                    break;
-                }
-            }
-
-            if (length == 0) {  // no more data to read indicates the end of the data source
+            const char *block;
+            size_t length;
+            if (!NextBlock(block, length, EntityBlockSize)) {  // no more data to read indicates the end of the data source
                 Data = true;
                 XML_Parse(Parser, nullptr, 0, 1);  // signal the parser that parsing is complete
                 break;
             }
 
-            if (XML_Parse(Parser, buffer.data(), length, 0) == XML_STATUS_ERROR) {
+            if (XML_Parse(Parser, block, length, 0) == XML_STATUS_ERROR) {
                 return false;  // handle parsing errors
             }
         }
@@ -103,6 +130,45 @@ struct CXMLReader::SImplementation {
 
         return false;  // return false if no more entities are available
     }
+
+    // replays entities ReadEntity has already queued, then parses the rest of
+    // the source in large blocks with events going straight to handler
+    bool Parse(CXMLHandler &handler) {
+        FlushCharData();
+        while (!Queue.empty()) {
+            const SXMLEntity &entity = Queue.front();
+            if (entity.DType == SXMLEntity::EType::StartElement) {
+                std::vector<const char *> attributes;
+                for (const auto &attr : entity.DAttributes) {
+                    attributes.push_back(attr.first.c_str());
+                    attributes.push_back(attr.second.c_str());
+                }
+                attributes.push_back(nullptr);
+                handler.StartElement(entity.DNameData.c_str(), attributes.data());
+            } else if (entity.DType == SXMLEntity::EType::EndElement) {
+                handler.EndElement(entity.DNameData.c_str());
+            } else {
+                handler.CharData(entity.DNameData.data(), entity.DNameData.size());
+            }
+            Queue.pop();
+        }
+
+        bool success = true;
+        Handler = &handler;
+        while (!Data) {
+            const char *block;
+            size_t length;
+            if (!NextBlock(block, length, ParseBlockSize)) {
+                Data = true;
+                success = XML_Parse(Parser, nullptr, 0, 1) != XML_STATUS_ERROR;
+            } else if (XML_Parse(Parser, block, length, 0) == XML_STATUS_ERROR) {
+                Data = true;  // expat cannot resume after an error
+                success = false;
+            }
+        }
+        Handler = nullptr;
+        return success;
+    }
 };
 
 // interface for creating an XML reader with a specific data source
@@ -121,3 +187,8 @@ bool CXMLReader::ReadEntity(SXMLEntity &entity, bool skipcdata) {
     return DImplementation->ReadEntity(entity, skipcdata);
 }
 
+// method to parse the rest of the document with events sent to a handler
+bool CXMLReader::Parse(CXMLHandler &handler) {
+    return DImplementation->Parse(handler);
+}
+
@@ -6,21 +6,25 @@
 struct CXMLWriter::SImplementation {
     std::shared_ptr<CDataSink> OutputSink;  // Output stream for XML data
     std::vector<std::string> OpenElements;  // Stack to track open elements
+    std::vector<char> Pending;  // text of the component being written, sent in one Write
 
     // constructor initializes the output sink
     explicit SImplementation(std::shared_ptr<CDataSink> sink) 
         : OutputSink(std::move(sink)) {}
 
-    // helper function to write raw text to the output sink
+    // helper function to queue raw text for the output sink
     bool Write(const std::string &text) {
-        for (char ch : text) {
-            if (!OutputSink->Put(ch)) {
-                return false;
-            }
-        }
+        Pending.insert(Pending.end(), text.begin(), text.end());
         return true;
     }
 
+    // hands the queued text to the output sink
+    bool Emit() {
+        bool success = OutputSink->Write(Pending);
+        Pending.clear();
+        return success;
+    }
+
     // writes text while escaping XML special characters
     bool WriteEscapedText(const std::string &text) {
         for (char ch : text) {
@@ -31,7 +35,7 @@ struct CXMLWriter::SImplementation {
                 case '\'': if (!Write("&apos;")) return false; break;
                 case '"':  if (!Write("&quot;")) return false; break;
                 default:
-                    if (!OutputSink->Put(ch)) return false;
+                    Pending.push_back(ch);
             }
         }
         return true;
@@ -47,7 +51,7 @@ struct CXMLWriter::SImplementation {
             }
             OpenElements.pop_back();
         }
-        return true;
+        return Emit();
     }
 
     // writes an XML entity based on its type (tag, text, or self-closing tag)
@@ -103,7 +107,7 @@ struct CXMLWriter::SImplementation {
                 if (!Write("/>")) return false;
                 break;
         }
-        return true;
+        return Emit();
     }
 };
 
@@ -116,7 +120,7 @@ CXMLWriter::~CXMLWriter() = default;
 
 // ensures all remaining open elements are closed before finalizing output
 bool CXMLWriter::Flush() {
-    return DImplementation->CloseAllOpenElements();
+    return DImplementation->CloseAllOpenElements() && DImplementation->OutputSink->Flush();
 }
 
 // writes an XML entity to the output
@@ -6,20 +6,28 @@
 #include "StandardDataSource.h"
 #include "StandardDataSink.h"
 #include "StandardErrorDataSink.h"
+#include "FileDataSink.h"
 #include "StringUtils.h"
+#include "DSVWriter.h"
 #include <iostream>
 #include <iomanip>
 #include <sstream>
 #include <chrono>
 #include <vector>
 #include <cmath>
+#include <algorithm>
+#include <atomic>
+#include <thread>
 
 class CArgumentParser{
     private:
         std::string DDataDirectory;
         std::string DResultsDirectory;
+        std::string DSnapshotFilename;
         uint64_t DNumPoints;
         uint64_t DSeed;
+        CDijkstraTransportationPlanner::ESearchStrategy DStrategy;
+        std::vector<std::size_t> DThreadCounts;
         bool DArgumentsValid;
         bool DVerbose;
         
@@ -31,14 +39,17 @@ class CArgumentParser{
 
         std::string DataDirectory() const;
         std::string ResultsDirectory() const;
+        std::string SnapshotFilename() const;
         bool Verbose() const;
         uint64_t NumPoints() const;
         uint64_t Seed() const;
+        CDijkstraTransportationPlanner::ESearchStrategy Strategy() const;
+        std::vector<std::size_t> ThreadCounts() const;
 };
 
 class CSpeedTest{
     private:
-        std::shared_ptr<CTransportationPlanner> DPlanner;
+        std::shared_ptr<CDijkstraTransportationPlanner> DPlanner;
         std::shared_ptr<CDataSink> DOutput;
         std::shared_ptr<CDataSink> DNotify;
         bool DViolatedPrecomputeTime;
@@ -48,20 +59,41 @@ class CSpeedTest{
         std::vector< double > DFastestTime;
         uint64_t DLoadDurationCount;
         uint64_t DProcessingDurationCount;
+        std::vector< std::pair< CStreetMap::TNodeID , CStreetMap::TNodeID > > DNodePairs;
+
+        // latency distribution of one query type at one thread count
+        struct SLatencyResult{
+            std::size_t DThreadCount;
+            std::string DQueryType;
+            std::vector< double > DLatencies; // milliseconds, sorted
+            double DWallMilliseconds;
+        };
+        std::vector< SLatencyResult > DLatencyResults;
 
         static std::string DistanceToString(double dist);
         static std::string TimeToString(double dur);
         static std::string ShortestPathToNodeString(const std::vector< CStreetMap::TNodeID > &path);
         static std::string FastestPathToNodeString(const std::vector< CTransportationPlanner::TTripStep > &path);
+        static double Percentile(const std::vector< double > &sorted, double fraction);
+        static std::string MillisecondsToString(double ms);
+
+        template <typename TQuery>
+        SLatencyResult MeasureLatency(std::size_t threadcount, const std::string &querytype, TQuery query);
 
         void OutputString(const std::string &str);
         void NotifyString(const std::string &str);
         void WriteStringToSink(std::shared_ptr<CDataSink> sink, const std::string &str);
     public:
-        CSpeedTest(std::shared_ptr<CDataSink> out, std::shared_ptr<CDataSink> notify, std::shared_ptr<CTransportationPlanner::SConfiguration> config);
+        CSpeedTest(std::shared_ptr<CDataSink> out, std::shared_ptr<CDataSink> notify, std::shared_ptr<CTransportationPlanner::SConfiguration> config, CDijkstraTransportationPlanner::ESearchStrategy strategy);
+        CSpeedTest(std::shared_ptr<CDataSink> out, std::shared_ptr<CDataSink> notify, const std::string &snapshot, CDijkstraTransportationPlanner::ESearchStrategy strategy);
+
+        bool Loaded() const;
+        bool WriteSnapshot(std::shared_ptr<CDataSink> sink);
 
         bool RunTest(uint64_t seed, uint64_t numpoints, bool verbose);
+        bool RunLatencyTest(const std::vector<std::size_t> &threadcounts);
         bool OutputResults(std::shared_ptr<CDataFactory> results, bool verbose);
+        bool OutputLatencyResults(std::shared_ptr<CDataFactory> results);
 };
 
 int main(int argc, char *argv[]){
@@ -84,18 +116,36 @@ int main(int argc, char *argv[]){
     auto StdIn = std::make_shared<CStandardDataSource>();
     auto StdOut = std::make_shared<CStandardDataSink>();
     auto StdErr = std::make_shared<CStandardErrorDataSink>();
-    auto StopReader = std::make_shared<CDSVReader>(DataFactory->CreateSource(StopFilename),',');
-    auto RouteReader = std::make_shared<CDSVReader>(DataFactory->CreateSource(RouteFilename),',');
-    auto BusSystem = std::make_shared<CCSVBusSystem>(StopReader, RouteReader);
-    auto XMLReader = std::make_shared<CXMLReader>(DataFactory->CreateSource(OSMFilename));
-    auto StreetMap = std::make_shared<COpenStreetMap>(XMLReader);
-    auto PlannerConfig = std::make_shared<STransportationPlannerConfig>(StreetMap, BusSystem);
+    std::shared_ptr<CSpeedTest> Tester;
 
-    CSpeedTest SpeedTester(StdOut,StdErr,PlannerConfig);
+    // A snapshot from an earlier run skips parsing and building the planner
+    if(!Parser.SnapshotFilename().empty()){
+        Tester = std::make_shared<CSpeedTest>(StdOut,StdErr,Parser.SnapshotFilename(),Parser.Strategy());
+    }
+    if(!Tester || !Tester->Loaded()){
+        // feeds of a megabyte or more are split across every core
+        auto StopReader = std::make_shared<CDSVReader>(DataFactory->CreateSource(StopFilename),',',0);
+        auto RouteReader = std::make_shared<CDSVReader>(DataFactory->CreateSource(RouteFilename),',',0);
+        auto BusSystem = std::make_shared<CCSVBusSystem>(StopReader, RouteReader);
+        auto XMLReader = std::make_shared<CXMLReader>(DataFactory->CreateSource(OSMFilename));
+        auto StreetMap = std::make_shared<COpenStreetMap>(XMLReader);
+        auto PlannerConfig = std::make_shared<STransportationPlannerConfig>(StreetMap, BusSystem);
+
+        Tester = std::make_shared<CSpeedTest>(StdOut,StdErr,PlannerConfig,Parser.Strategy());
+        if(!Parser.SnapshotFilename().empty() && !Tester->WriteSnapshot(std::make_shared<CFileDataSink>(Parser.SnapshotFilename()))){
+            return EXIT_FAILURE;
+        }
+    }
+    CSpeedTest &SpeedTester = *Tester;
 
     if(SpeedTester.RunTest(Parser.Seed(),Parser.NumPoints(),Parser.Verbose())){
         if(SpeedTester.OutputResults(ResultsFactory,Parser.Verbose())){
-            return EXIT_SUCCESS;        
+            if(Parser.ThreadCounts().empty()){
+                return EXIT_SUCCESS;
+            }
+            if(SpeedTester.RunLatencyTest(Parser.ThreadCounts()) && SpeedTester.OutputLatencyResults(ResultsFactory)){
+                return EXIT_SUCCESS;
+            }
         }
     }
 
@@ -108,6 +158,7 @@ CArgumentParser::CArgumentParser(const std::vector<std::string> &args){
     DArgumentsValid = true;
     DNumPoints = 0;
     DSeed = 0;
+    DStrategy = CDijkstraTransportationPlanner::ESearchStrategy::Dijkstra;
     DVerbose = false;
     for(auto &Argument : args){
         if(Argument.find("--data") == 0){
@@ -126,6 +177,14 @@ CArgumentParser::CArgumentParser(const std::vector<std::string> &args){
             }
             DResultsDirectory = SplitArg[1];
         }
+        else if(Argument.find("--snapshot") == 0){
+            auto SplitArg = StringUtils::Split(Argument,"=");
+            if(SplitArg.size() != 2 || SplitArg[0] != "--snapshot" || SplitArg[1].empty()){
+                DArgumentsValid = false;
+                break;
+            }
+            DSnapshotFilename = SplitArg[1];
+        }
         else if(Argument.find("--seed") == 0){
             auto SplitArg = StringUtils::Split(Argument,"=");
             if(SplitArg.size() != 2 || SplitArg[0] != "--seed"){
@@ -134,6 +193,43 @@ CArgumentParser::CArgumentParser(const std::vector<std::string> &args){
             }
             DSeed = std::stoull(SplitArg[1]);
         }
+        else if(Argument.find("--strategy") == 0){
+            auto SplitArg = StringUtils::Split(Argument,"=");
+            if(SplitArg.size() != 2 || SplitArg[0] != "--strategy"){
+                DArgumentsValid = false;
+                break;
+            }
+            if(SplitArg[1] == "dijkstra"){
+                DStrategy = CDijkstraTransportationPlanner::ESearchStrategy::Dijkstra;
+            }
+            else if(SplitArg[1] == "astar"){
+                DStrategy = CDijkstraTransportationPlanner::ESearchStrategy::AStar;
+            }
+            else if(SplitArg[1] == "raptor"){
+                DStrategy = CDijkstraTransportationPlanner::ESearchStrategy::Raptor;
+            }
+            else{
+                DArgumentsValid = false;
+                break;
+            }
+        }
+        else if(Argument.find("--threads") == 0){
+            auto SplitArg = StringUtils::Split(Argument,"=");
+            if(SplitArg.size() != 2 || SplitArg[0] != "--threads"){
+                DArgumentsValid = false;
+                break;
+            }
+            for(auto &Count : StringUtils::Split(SplitArg[1],",")){
+                if(Count.empty() || Count.find_first_not_of("0123456789") != std::string::npos || !std::stoull(Count)){
+                    DArgumentsValid = false;
+                    break;
+                }
+                DThreadCounts.push_back(std::stoull(Count));
+            }
+            if(!DArgumentsValid){
+                break;
+            }
+        }
         else if(Argument == "--verbose"){
             DVerbose = true;
         }
@@ -159,7 +255,7 @@ CArgumentParser::CArgumentParser(const std::vector<std::string> &args){
 }
 
 void CArgumentParser::PrintSyntax() const{
-    std::cerr<<"Syntax Error: speedtest [--data=path | --results=path | --seed=rngseed | --verbose] [numpoints]"<<std::endl;
+    std::cerr<<"Syntax Error: speedtest [--data=path | --results=path | --snapshot=file | --seed=rngseed | --strategy=dijkstra|astar|raptor | --threads=n[,n...] | --verbose] [numpoints]"<<std::endl;
 }
 
 bool CArgumentParser::ArgumentsValid() const{
@@ -174,6 +270,10 @@ std::string CArgumentParser::ResultsDirectory() const{
     return DResultsDirectory;
 }
 
+std::string CArgumentParser::SnapshotFilename() const{
+    return DSnapshotFilename;
+}
+
 bool CArgumentParser::Verbose() const{
     return DVerbose;
 }
@@ -186,13 +286,23 @@ uint64_t CArgumentParser::Seed() const{
     return DSeed;
 }
 
-CSpeedTest::CSpeedTest(std::shared_ptr<CDataSink> out, std::shared_ptr<CDataSink> notify, std::shared_ptr<CTransportationPlanner::SConfiguration> config){
+CDijkstraTransportationPlanner::ESearchStrategy CArgumentParser::Strategy() const{
+    return DStrategy;
+}
+
+std::vector<std::size_t> CArgumentParser::ThreadCounts() const{
+    return DThreadCounts;
+}
+
+CSpeedTest::CSpeedTest(std::shared_ptr<CDataSink> out, std::shared_ptr<CDataSink> notify, std::shared_ptr<CTransportationPlanner::SConfiguration> config, CDijkstraTransportationPlanner::ESearchStrategy strategy){
     const int MillisecondsPerSecond = 1000;
     DOutput = out;
     DNotify = notify;
     NotifyString("Loading\n");
     auto LoadStart = std::chrono::steady_clock::now();
-    DPlanner = std::make_shared<CDijkstraTransportationPlanner>(config);
+    auto Planner = std::make_shared<CDijkstraTransportationPlanner>(config);
+    Planner->SetSearchStrategy(strategy);
+    DPlanner = Planner;
     auto LoadDuration = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now()-LoadStart);
     NotifyString("Loaded\n");
     DViolatedPrecomputeTime = config->PrecomputeTime() * MillisecondsPerSecond < LoadDuration.count();
@@ -202,6 +312,36 @@ CSpeedTest::CSpeedTest(std::shared_ptr<CDataSink> out, std::shared_ptr<CDataSink
     DLoadDurationCount = LoadDuration.count();
 }
 
+CSpeedTest::CSpeedTest(std::shared_ptr<CDataSink> out, std::shared_ptr<CDataSink> notify, const std::string &snapshot, CDijkstraTransportationPlanner::ESearchStrategy strategy){
+    DOutput = out;
+    DNotify = notify;
+    NotifyString("Loading snapshot\n");
+    auto LoadStart = std::chrono::steady_clock::now();
+    DPlanner = CDijkstraTransportationPlanner::LoadSnapshot(snapshot);
+    if(DPlanner){
+        // the strategy may build its tables, count them as loading
+        DPlanner->SetSearchStrategy(strategy);
+    }
+    auto LoadDuration = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now()-LoadStart);
+    DLoadDurationCount = LoadDuration.count();
+    // the precompute time was spent when the snapshot was written
+    DViolatedPrecomputeTime = false;
+    if(!DPlanner){
+        NotifyString("Snapshot missing or outdated\n");
+        return;
+    }
+    NotifyString("Loaded\n");
+}
+
+bool CSpeedTest::Loaded() const{
+    return DPlanner != nullptr;
+}
+
+bool CSpeedTest::WriteSnapshot(std::shared_ptr<CDataSink> sink){
+    NotifyString("Writing snapshot\n");
+    return DPlanner->WriteSnapshot(sink);
+}
+
 std::string CSpeedTest::DistanceToString(double dist){
     if(CPathRouter::NoPathExists == dist){
         return "(N/A)";
@@ -276,6 +416,21 @@ std::string CSpeedTest::FastestPathToNodeString(const std::vector< CTransportati
     return ReturnString;
 }
 
+double CSpeedTest::Percentile(const std::vector< double > &sorted, double fraction){
+    if(sorted.empty()){
+        return 0.0;
+    }
+    // Nearest rank, the smallest sample at or above the fraction of samples
+    auto Rank = std::size_t(std::ceil(fraction * sorted.size()));
+    return sorted[Rank ? Rank - 1 : 0];
+}
+
+std::string CSpeedTest::MillisecondsToString(double ms){
+    std::stringstream TempStringStream;
+    TempStringStream<<std::fixed<<std::setprecision(4)<<ms;
+    return TempStringStream.str();
+}
+
 void CSpeedTest::OutputString(const std::string &str){
     WriteStringToSink(DOutput,str);
 }
@@ -291,7 +446,8 @@ void CSpeedTest::WriteStringToSink(std::shared_ptr<CDataSink> sink, const std::s
 bool CSpeedTest::RunTest(uint64_t seed, uint64_t numpoints, bool verbose){
     std::vector< CStreetMap::TNodeID > TempShortestPath;
     std::vector< CTransportationPlanner::TTripStep > TempFastestPath;
-    std::vector< std::pair< CStreetMap::TNodeID , CStreetMap::TNodeID > > RandomNodePairs;
+    std::vector< std::pair< CStreetMap::TNodeID , CStreetMap::TNodeID > > &RandomNodePairs = DNodePairs;
+    RandomNodePairs.clear();
     srand(seed);
     NotifyString("Generating src/dest pairs\n");
     for(uint64_t Index = 0; Index < numpoints; Index++){
@@ -324,6 +480,71 @@ bool CSpeedTest::RunTest(uint64_t seed, uint64_t numpoints, bool verbose){
     return true;
 }
 
+template <typename TQuery>
+CSpeedTest::SLatencyResult CSpeedTest::MeasureLatency(std::size_t threadcount, const std::string &querytype, TQuery query){
+    SLatencyResult Result{threadcount, querytype, std::vector< double >(DNodePairs.size()), 0.0};
+    std::atomic< std::size_t > NextIndex(0);
+    auto Worker = [&](){
+        std::vector< CStreetMap::TNodeID > ShortestPath;
+        std::vector< CTransportationPlanner::TTripStep > FastestPath;
+        for(std::size_t Index = NextIndex++; Index < DNodePairs.size(); Index = NextIndex++){
+            auto QueryStart = std::chrono::steady_clock::now();
+            query(DNodePairs[Index], ShortestPath, FastestPath);
+            Result.DLatencies[Index] = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - QueryStart).count();
+        }
+    };
+    auto WallStart = std::chrono::steady_clock::now();
+    std::vector< std::thread > Workers;
+    for(std::size_t Index = 0; Index < threadcount; Index++){
+        Workers.emplace_back(Worker);
+    }
+    for(auto &Thread : Workers){
+        Thread.join();
+    }
+    Result.DWallMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - WallStart).count();
+    std::sort(Result.DLatencies.begin(), Result.DLatencies.end());
+    return Result;
+}
+
+bool CSpeedTest::RunLatencyTest(const std::vector<std::size_t> &threadcounts){
+    // Queries are shared by the workers, so the planner must be safe to
+    // query concurrently
+    DLatencyResults.clear();
+    for(auto ThreadCount : threadcounts){
+        NotifyString("Measuring latency with " + std::to_string(ThreadCount) + " threads\n");
+        DLatencyResults.push_back(MeasureLatency(ThreadCount,"shortest",[this](const auto &pair, auto &shortestpath, auto &){
+            DPlanner->FindShortestPath(std::get<0>(pair), std::get<1>(pair), shortestpath);
+        }));
+        DLatencyResults.push_back(MeasureLatency(ThreadCount,"fastest",[this](const auto &pair, auto &, auto &fastestpath){
+            DPlanner->FindFastestPath(std::get<0>(pair), std::get<1>(pair), fastestpath);
+        }));
+    }
+    return true;
+}
+
+bool CSpeedTest::OutputLatencyResults(std::shared_ptr<CDataFactory> results){
+    auto Sink = results->CreateSink("speed_test_latency.csv");
+    if(!Sink){
+        return false;
+    }
+    CDSVWriter Writer(Sink,',');
+    Writer.WriteRow({"threads","query","count","p50_ms","p90_ms","p99_ms","max_ms","queries_per_sec"});
+    for(auto &Result : DLatencyResults){
+        auto QueriesPerSecond = Result.DWallMilliseconds > 0 ? Result.DLatencies.size() * 1000.0 / Result.DWallMilliseconds : 0.0;
+        std::vector< std::string > Row = {  std::to_string(Result.DThreadCount),
+                                            Result.DQueryType,
+                                            std::to_string(Result.DLatencies.size()),
+                                            MillisecondsToString(Percentile(Result.DLatencies,0.50)),
+                                            MillisecondsToString(Percentile(Result.DLatencies,0.90)),
+                                            MillisecondsToString(Percentile(Result.DLatencies,0.99)),
+                                            MillisecondsToString(Result.DLatencies.empty() ? 0.0 : Result.DLatencies.back()),
+                                            std::to_string(long(QueriesPerSecond))};
+        Writer.WriteRow(Row);
+        NotifyString(Row[0] + " threads " + Row[1] + ": p50 " + Row[3] + " ms, p90 " + Row[4] + " ms, p99 " + Row[5] + " ms, max " + Row[6] + " ms, " + Row[7] + " queries/s\n");
+    }
+    return Sink->Flush();
+}
+
 bool CSpeedTest::OutputResults(std::shared_ptr<CDataFactory> results, bool verbose){
     NotifyString("Outputting Results\n");
     auto Brief = results->CreateSink("speed_test_brief.txt");
@@ -347,5 +568,5 @@ bool CSpeedTest::OutputResults(std::shared_ptr<CDataFactory> results, bool verbo
 
     WriteStringToSink(Brief,Summary);
     NotifyString(Summary);
-    return true;
+    return Brief->Flush();
 }
\ No newline at end of file
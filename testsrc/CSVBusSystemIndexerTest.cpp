@@ -81,4 +81,53 @@ TEST(CSVBusSystemIndexer, RouteTest){
     EXPECT_TRUE(Routes.find(Route1Index) != Routes.end());
     EXPECT_TRUE(Routes.find(Route2Index) != Routes.end());
 
-}
\ No newline at end of file
+}
+TEST(CSVBusSystemIndexer, RouteOrderTest){
+    auto InStreamStops = std::make_shared<CStringDataSource>(   "stop_id,node_id\n"
+                                                                "0,100\n"
+                                                                "1,101\n"
+                                                                "2,102\n"
+                                                                "3,103\n"
+                                                                "4,102");
+    auto InStreamRoutes = std::make_shared<CStringDataSource>(  "route,stop_id\n"
+                                                                "A,0\n"
+                                                                "A,1\n"
+                                                                "A,2\n"
+                                                                "B,2\n"
+                                                                "B,1\n"
+                                                                "C,1\n"
+                                                                "C,3\n"
+                                                                "C,1");
+    auto CSVReaderStops = std::make_shared<CDSVReader>(InStreamStops,',');
+    auto CSVReaderRoutes = std::make_shared<CDSVReader>(InStreamRoutes,',');
+    auto BusSystem = std::make_shared<CCSVBusSystem>(CSVReaderStops, CSVReaderRoutes);
+    CBusSystemIndexer BusSystemIndexer(BusSystem);
+
+    auto RouteA = BusSystem->RouteByName("A");
+    auto RouteB = BusSystem->RouteByName("B");
+    auto RouteC = BusSystem->RouteByName("C");
+    ASSERT_TRUE(bool(BusSystemIndexer.StopByNodeID(100)));
+    EXPECT_EQ(BusSystemIndexer.StopByNodeID(100)->ID(),0);
+    ASSERT_TRUE(bool(BusSystemIndexer.StopByNodeID(102)));
+    EXPECT_EQ(BusSystemIndexer.StopByNodeID(102)->ID(),2);
+    EXPECT_FALSE(bool(BusSystemIndexer.StopByNodeID(104)));
+
+    std::unordered_set< std::shared_ptr<CBusSystem::SRoute> > Routes;
+    EXPECT_TRUE(BusSystemIndexer.RoutesByNodeIDs(100,102,Routes));
+    EXPECT_EQ(Routes,std::unordered_set< std::shared_ptr<CBusSystem::SRoute> >({RouteA}));
+    Routes.clear();
+    EXPECT_TRUE(BusSystemIndexer.RoutesByNodeIDs(101,102,Routes));
+    EXPECT_EQ(Routes,std::unordered_set< std::shared_ptr<CBusSystem::SRoute> >({RouteA}));
+    Routes.clear();
+    EXPECT_TRUE(BusSystemIndexer.RoutesByNodeIDs(102,101,Routes));
+    EXPECT_EQ(Routes,std::unordered_set< std::shared_ptr<CBusSystem::SRoute> >({RouteB}));
+    Routes.clear();
+    EXPECT_TRUE(BusSystemIndexer.RoutesByNodeIDs(103,101,Routes));
+    EXPECT_EQ(Routes,std::unordered_set< std::shared_ptr<CBusSystem::SRoute> >({RouteC}));
+    Routes.clear();
+    EXPECT_FALSE(BusSystemIndexer.RoutesByNodeIDs(102,100,Routes));
+    EXPECT_TRUE(Routes.empty());
+    EXPECT_FALSE(BusSystemIndexer.RoutesByNodeIDs(103,104,Routes));
+    EXPECT_TRUE(BusSystemIndexer.RouteBetweenNodeIDs(101,103));
+    EXPECT_FALSE(BusSystemIndexer.RouteBetweenNodeIDs(103,100));
+}
@@ -7,6 +7,10 @@
 #include "TransportationPlannerConfig.h"
 #include "DijkstraTransportationPlanner.h"
 #include "GeographicUtils.h"
+#include "FileDataSink.h"
+#include <filesystem>
+#include <fstream>
+#include <algorithm>
 
 TEST(CSVOSMTransporationPlanner, SimpleTest){
     auto InStreamOSM = std::make_shared<CStringDataSource>( "<?xml version='1.0' encoding='UTF-8'?>"
@@ -293,4 +297,510 @@ TEST(CSVOSMTransporationPlanner, PathDescription){
     EXPECT_TRUE(Planner.GetPathDescription(Path3,Description3));
     EXPECT_EQ(Description3, ExpectedDescription3);
 
-}
\ No newline at end of file
+}
+TEST(CSVOSMTransporationPlanner, AStarTest){
+    auto InStreamOSM = std::make_shared<CStringDataSource>( "<?xml version='1.0' encoding='UTF-8'?>"
+                                                            "<osm version=\"0.6\" generator=\"osmconvert 0.8.5\">"
+                                                            "<node id=\"1\" lat=\"38.5\" lon=\"-121.7\"/>"
+                                                            "<node id=\"2\" lat=\"38.6\" lon=\"-121.7\"/>"
+                                                            "<node id=\"3\" lat=\"38.6\" lon=\"-121.8\"/>"
+                                                            "<node id=\"4\" lat=\"38.5\" lon=\"-121.8\"/>"
+                                                            "<node id=\"5\" lat=\"38.4\" lon=\"-121.75\"/>"
+                                                            "<way id=\"10\">"
+                                                            "<nd ref=\"1\"/>"
+                                                            "<nd ref=\"2\"/>"
+                                                            "<nd ref=\"3\"/>"
+                                                            "<tag k=\"oneway\" v=\"yes\"/>"
+                                                            "</way>"
+                                                            "<way id=\"11\">"
+                                                            "<nd ref=\"3\"/>"
+                                                            "<nd ref=\"4\"/>"
+                                                            "<nd ref=\"1\"/>"
+                                                            "<tag k=\"oneway\" v=\"yes\"/>"
+                                                            "</way>"
+                                                            "<way id=\"12\">"
+                                                            "<nd ref=\"1\"/>"
+                                                            "<nd ref=\"5\"/>"
+                                                            "<nd ref=\"4\"/>"
+                                                            "<tag k=\"maxspeed\" v=\"45 mph\"/>"
+                                                            "</way>"
+                                                            "</osm>");
+    auto InStreamStops = std::make_shared<CStringDataSource>("stop_id,node_id");
+    auto InStreamRoutes = std::make_shared<CStringDataSource>("route,stop_id");
+    auto XMLReader = std::make_shared<CXMLReader>(InStreamOSM);
+    auto CSVReaderStops = std::make_shared<CDSVReader>(InStreamStops,',');
+    auto CSVReaderRoutes = std::make_shared<CDSVReader>(InStreamRoutes,',');
+    auto StreetMap = std::make_shared<COpenStreetMap>(XMLReader);
+    auto BusSystem = std::make_shared<CCSVBusSystem>(CSVReaderStops, CSVReaderRoutes);
+    auto Config = std::make_shared<STransportationPlannerConfig>(StreetMap,BusSystem);
+    CDijkstraTransportationPlanner Planner(Config);
+    EXPECT_EQ(Planner.SearchStrategy(),CDijkstraTransportationPlanner::ESearchStrategy::Dijkstra);
+    std::vector< CTransportationPlanner::TNodeID > DijkstraShortestPath, AStarShortestPath;
+    std::vector< CTransportationPlanner::TTripStep > DijkstraFastestPath, AStarFastestPath;
+    for(CTransportationPlanner::TNodeID Source = 1; Source <= 5; Source++){
+        for(CTransportationPlanner::TNodeID Dest = 1; Dest <= 5; Dest++){
+            Planner.SetSearchStrategy(CDijkstraTransportationPlanner::ESearchStrategy::Dijkstra);
+            double DijkstraDistance = Planner.FindShortestPath(Source,Dest,DijkstraShortestPath);
+            double DijkstraTime = Planner.FindFastestPath(Source,Dest,DijkstraFastestPath);
+            Planner.SetSearchStrategy(CDijkstraTransportationPlanner::ESearchStrategy::AStar);
+            EXPECT_EQ(Planner.FindShortestPath(Source,Dest,AStarShortestPath),DijkstraDistance);
+            EXPECT_EQ(AStarShortestPath,DijkstraShortestPath);
+            EXPECT_EQ(Planner.FindFastestPath(Source,Dest,AStarFastestPath),DijkstraTime);
+            EXPECT_EQ(AStarFastestPath,DijkstraFastestPath);
+        }
+    }
+}
+
+TEST(CSVOSMTransporationPlanner, AStarSettledTest){
+    // 8x8 grid with a way along every row and column in both directions and a bus along the middle row
+    std::string OSM = "<?xml version='1.0' encoding='UTF-8'?><osm version=\"0.6\" generator=\"osmconvert 0.8.5\">";
+    for(int Row = 0; Row < 8; Row++){
+        for(int Col = 0; Col < 8; Col++){
+            OSM += "<node id=\"" + std::to_string(Row * 8 + Col + 1) + "\" lat=\"" + std::to_string(38.5 + Row * 0.01) + "\" lon=\"" + std::to_string(-121.7 - Col * 0.01) + "\"/>";
+        }
+    }
+    int WayID = 100;
+    for(int Line = 0; Line < 8; Line++){
+        std::string RowWay = "<way id=\"" + std::to_string(WayID++) + "\">", ColWay = "<way id=\"" + std::to_string(WayID++) + "\">";
+        for(int Step = 0; Step < 8; Step++){
+            RowWay += "<nd ref=\"" + std::to_string(Line * 8 + Step + 1) + "\"/>";
+            ColWay += "<nd ref=\"" + std::to_string(Step * 8 + Line + 1) + "\"/>";
+        }
+        OSM += RowWay + "</way>" + ColWay + "</way>";
+    }
+    OSM += "</osm>";
+    auto InStreamOSM = std::make_shared<CStringDataSource>(OSM);
+    auto InStreamStops = std::make_shared<CStringDataSource>("stop_id,node_id\n1,33\n2,36\n3,40");
+    auto InStreamRoutes = std::make_shared<CStringDataSource>("route,stop_id\nA,1\nA,2\nA,3");
+    auto XMLReader = std::make_shared<CXMLReader>(InStreamOSM);
+    auto CSVReaderStops = std::make_shared<CDSVReader>(InStreamStops,',');
+    auto CSVReaderRoutes = std::make_shared<CDSVReader>(InStreamRoutes,',');
+    auto StreetMap = std::make_shared<COpenStreetMap>(XMLReader);
+    auto BusSystem = std::make_shared<CCSVBusSystem>(CSVReaderStops, CSVReaderRoutes);
+    // no time to precompute, so shortest paths search the street graph too
+    auto Config = std::make_shared<STransportationPlannerConfig>(StreetMap,BusSystem,3.0,8.0,25.0,30.0,0);
+    CDijkstraTransportationPlanner Planner(Config);
+    std::vector< CTransportationPlanner::TNodeID > DijkstraShortestPath, AStarShortestPath;
+    std::vector< CTransportationPlanner::TTripStep > DijkstraFastestPath, AStarFastestPath;
+    // Goal direction settles fewer vertices across the bottom row
+    Planner.SetSearchStrategy(CDijkstraTransportationPlanner::ESearchStrategy::Dijkstra);
+    double DijkstraDistance = Planner.FindShortestPath(1,8,DijkstraShortestPath);
+    std::size_t DijkstraShortestSettled = Planner.SettledVertexCount();
+    double DijkstraTime = Planner.FindFastestPath(1,8,DijkstraFastestPath);
+    std::size_t DijkstraFastestSettled = Planner.SettledVertexCount();
+    Planner.SetSearchStrategy(CDijkstraTransportationPlanner::ESearchStrategy::AStar);
+    EXPECT_EQ(Planner.FindShortestPath(1,8,AStarShortestPath),DijkstraDistance);
+    EXPECT_EQ(AStarShortestPath,DijkstraShortestPath);
+    EXPECT_LT(Planner.SettledVertexCount(),DijkstraShortestSettled);
+    EXPECT_EQ(Planner.FindFastestPath(1,8,AStarFastestPath),DijkstraTime);
+    EXPECT_EQ(AStarFastestPath,DijkstraFastestPath);
+    EXPECT_LT(Planner.SettledVertexCount(),DijkstraFastestSettled);
+    // The estimate never overestimates, with or without the bus
+    for(CTransportationPlanner::TNodeID Source = 1; Source <= 64; Source += 5){
+        for(CTransportationPlanner::TNodeID Dest = 1; Dest <= 64; Dest += 3){
+            Planner.SetSearchStrategy(CDijkstraTransportationPlanner::ESearchStrategy::Dijkstra);
+            DijkstraTime = Planner.FindFastestPath(Source,Dest,DijkstraFastestPath);
+            Planner.SetSearchStrategy(CDijkstraTransportationPlanner::ESearchStrategy::AStar);
+            EXPECT_DOUBLE_EQ(Planner.FindFastestPath(Source,Dest,AStarFastestPath),DijkstraTime);
+        }
+    }
+}
+
+TEST(CSVOSMTransporationPlanner, BatchTest){
+    // 4x4 grid with a way along every row and column in both directions
+    std::string OSM = "<?xml version='1.0' encoding='UTF-8'?><osm version=\"0.6\" generator=\"osmconvert 0.8.5\">";
+    for(int Row = 0; Row < 4; Row++){
+        for(int Col = 0; Col < 4; Col++){
+            OSM += "<node id=\"" + std::to_string(Row * 4 + Col + 1) + "\" lat=\"" + std::to_string(38.5 + Row * 0.01) + "\" lon=\"" + std::to_string(-121.7 - Col * 0.01) + "\"/>";
+        }
+    }
+    int WayID = 100;
+    for(int Line = 0; Line < 4; Line++){
+        for(int Reverse = 0; Reverse < 2; Reverse++){
+            std::string RowWay = "<way id=\"" + std::to_string(WayID++) + "\">", ColWay = "<way id=\"" + std::to_string(WayID++) + "\">";
+            for(int Step = 0; Step < 4; Step++){
+                int Index = Reverse ? 3 - Step : Step;
+                RowWay += "<nd ref=\"" + std::to_string(Line * 4 + Index + 1) + "\"/>";
+                ColWay += "<nd ref=\"" + std::to_string(Index * 4 + Line + 1) + "\"/>";
+            }
+            OSM += RowWay + "</way>" + ColWay + "</way>";
+        }
+    }
+    OSM += "</osm>";
+    auto InStreamOSM = std::make_shared<CStringDataSource>(OSM);
+    auto InStreamStops = std::make_shared<CStringDataSource>("stop_id,node_id\n1,1\n2,6\n3,16");
+    auto InStreamRoutes = std::make_shared<CStringDataSource>("route,stop_id\nA,1\nA,2\nA,3");
+    auto XMLReader = std::make_shared<CXMLReader>(InStreamOSM);
+    auto CSVReaderStops = std::make_shared<CDSVReader>(InStreamStops,',');
+    auto CSVReaderRoutes = std::make_shared<CDSVReader>(InStreamRoutes,',');
+    auto StreetMap = std::make_shared<COpenStreetMap>(XMLReader);
+    auto BusSystem = std::make_shared<CCSVBusSystem>(CSVReaderStops, CSVReaderRoutes);
+    auto Config = std::make_shared<STransportationPlannerConfig>(StreetMap,BusSystem);
+    CDijkstraTransportationPlanner Planner(Config);
+    ASSERT_EQ(Planner.NodeCount(),16);
+
+    std::vector< CDijkstraTransportationPlanner::TQuery > Queries;
+    for(CTransportationPlanner::TNodeID Source = 1; Source <= 16; Source++){
+        for(CTransportationPlanner::TNodeID Dest = 1; Dest <= 17; Dest++){
+            Queries.push_back({Source,Dest});
+        }
+    }
+    std::vector< std::vector< CTransportationPlanner::TNodeID > > ShortestPaths;
+    std::vector< std::vector< CTransportationPlanner::TTripStep > > FastestPaths;
+    auto Distances = Planner.FindShortestPaths(Queries,ShortestPaths,4);
+    auto Times = Planner.FindFastestPaths(Queries,FastestPaths,4);
+    ASSERT_EQ(Distances.size(),Queries.size());
+    ASSERT_EQ(ShortestPaths.size(),Queries.size());
+    ASSERT_EQ(Times.size(),Queries.size());
+    ASSERT_EQ(FastestPaths.size(),Queries.size());
+    for(std::size_t Index = 0; Index < Queries.size(); Index++){
+        std::vector< CTransportationPlanner::TNodeID > ShortestPath;
+        std::vector< CTransportationPlanner::TTripStep > FastestPath;
+        EXPECT_EQ(Planner.FindShortestPath(Queries[Index].first,Queries[Index].second,ShortestPath),Distances[Index]);
+        EXPECT_EQ(ShortestPath,ShortestPaths[Index]);
+        EXPECT_EQ(Planner.FindFastestPath(Queries[Index].first,Queries[Index].second,FastestPath),Times[Index]);
+        EXPECT_EQ(FastestPath,FastestPaths[Index]);
+    }
+    // Node 17 does not exist
+    EXPECT_EQ(Distances[16],CPathRouter::NoPathExists);
+    EXPECT_TRUE(Planner.FindShortestPaths({},ShortestPaths).empty());
+    EXPECT_TRUE(ShortestPaths.empty());
+}
+
+TEST(CSVOSMTransporationPlanner, SnapshotTest){
+    const std::string Filename = (std::filesystem::temp_directory_path() / "CSVOSMTransportationPlannerSnapshot.bin").string();
+    auto InStreamOSM = std::make_shared<CStringDataSource>( "<?xml version='1.0' encoding='UTF-8'?>"
+                                                            "<osm version=\"0.6\" generator=\"osmconvert 0.8.5\">"
+                                                            "<node id=\"4\" lat=\"38.5\" lon=\"-121.8\"/>"
+                                                            "<node id=\"1\" lat=\"38.5\" lon=\"-121.7\">"
+                                                            "<tag k=\"highway\" v=\"traffic_signals\"/>"
+                                                            "</node>"
+                                                            "<node id=\"2\" lat=\"38.6\" lon=\"-121.7\"/>"
+                                                            "<node id=\"3\" lat=\"38.6\" lon=\"-121.8\"/>"
+                                                            "<way id=\"10\">"
+                                                            "<nd ref=\"1\"/>"
+                                                            "<nd ref=\"2\"/>"
+                                                            "<nd ref=\"3\"/>"
+                                                            "<nd ref=\"4\"/>"
+                                                            "<nd ref=\"1\"/>"
+                                                            "<tag k=\"name\" v=\"Main St.\"/>"
+                                                            "<tag k=\"maxspeed\" v=\"35 mph\"/>"
+                                                            "</way>"
+                                                            "<way id=\"11\">"
+                                                            "<nd ref=\"1\"/>"
+                                                            "<nd ref=\"3\"/>"
+                                                            "</way>"
+                                                            "</osm>");
+    auto InStreamStops = std::make_shared<CStringDataSource>("stop_id,node_id\n1,1\n2,3");
+    auto InStreamRoutes = std::make_shared<CStringDataSource>("route,stop_id\nA,1\nA,2");
+    auto XMLReader = std::make_shared<CXMLReader>(InStreamOSM);
+    auto CSVReaderStops = std::make_shared<CDSVReader>(InStreamStops,',');
+    auto CSVReaderRoutes = std::make_shared<CDSVReader>(InStreamRoutes,',');
+    auto StreetMap = std::make_shared<COpenStreetMap>(XMLReader);
+    auto BusSystem = std::make_shared<CCSVBusSystem>(CSVReaderStops, CSVReaderRoutes);
+    auto Config = std::make_shared<STransportationPlannerConfig>(StreetMap,BusSystem);
+    CDijkstraTransportationPlanner Planner(Config);
+    EXPECT_TRUE(Planner.WriteSnapshot(std::make_shared<CFileDataSink>(Filename)));
+
+    auto Loaded = CDijkstraTransportationPlanner::LoadSnapshot(Filename);
+    ASSERT_TRUE(bool(Loaded));
+    ASSERT_EQ(Loaded->NodeCount(),Planner.NodeCount());
+    for(std::size_t Index = 0; Index < Planner.NodeCount(); Index++){
+        auto Node = Planner.SortedNodeByIndex(Index), LoadedNode = Loaded->SortedNodeByIndex(Index);
+        ASSERT_TRUE(bool(LoadedNode));
+        EXPECT_EQ(LoadedNode->ID(),Node->ID());
+        EXPECT_EQ(LoadedNode->Location(),Node->Location());
+        EXPECT_EQ(LoadedNode->AttributeCount(),Node->AttributeCount());
+    }
+    EXPECT_EQ(Loaded->SortedNodeByIndex(0)->GetAttribute("highway"),"traffic_signals");
+    for(CTransportationPlanner::TNodeID Source = 1; Source <= 4; Source++){
+        for(CTransportationPlanner::TNodeID Dest = 1; Dest <= 4; Dest++){
+            std::vector< CTransportationPlanner::TNodeID > ShortestPath, LoadedShortestPath;
+            std::vector< CTransportationPlanner::TTripStep > FastestPath, LoadedFastestPath;
+            EXPECT_EQ(Loaded->FindShortestPath(Source,Dest,LoadedShortestPath),Planner.FindShortestPath(Source,Dest,ShortestPath));
+            EXPECT_EQ(LoadedShortestPath,ShortestPath);
+            EXPECT_EQ(Loaded->FindFastestPath(Source,Dest,LoadedFastestPath),Planner.FindFastestPath(Source,Dest,FastestPath));
+            EXPECT_EQ(LoadedFastestPath,FastestPath);
+        }
+    }
+    // A snapshot of a loaded planner is identical to the original
+    const std::string Refilename = Filename + ".2";
+    EXPECT_TRUE(Loaded->WriteSnapshot(std::make_shared<CFileDataSink>(Refilename)));
+    auto FileSize = std::filesystem::file_size(Filename);
+    EXPECT_EQ(std::filesystem::file_size(Refilename),FileSize);
+
+    // Damaged snapshots are rejected or load without throwing
+    std::string Contents(FileSize,'\0');
+    std::ifstream(Filename,std::ios::binary).read(Contents.data(),FileSize);
+    const std::string Damagedname = Filename + ".damaged";
+    for(std::size_t Offset = 0; Offset < FileSize; Offset++){
+        std::string Damaged = Contents;
+        Damaged[Offset] ^= 0xff;
+        std::ofstream(Damagedname,std::ios::binary).write(Damaged.data(),Damaged.size());
+        EXPECT_NO_THROW(CDijkstraTransportationPlanner::LoadSnapshot(Damagedname));
+        std::ofstream(Damagedname,std::ios::binary).write(Contents.data(),Offset);
+        EXPECT_FALSE(bool(CDijkstraTransportationPlanner::LoadSnapshot(Damagedname)));
+    }
+    std::filesystem::remove(Damagedname);
+
+    // Truncated and missing snapshots are rejected
+    std::filesystem::resize_file(Filename,FileSize - 1);
+    EXPECT_FALSE(bool(CDijkstraTransportationPlanner::LoadSnapshot(Filename)));
+    std::filesystem::remove(Filename);
+    std::filesystem::remove(Refilename);
+    EXPECT_FALSE(bool(CDijkstraTransportationPlanner::LoadSnapshot(Filename)));
+}
+
+TEST(CSVOSMTransporationPlanner, TransitGraphTest){
+    auto InStreamOSM = std::make_shared<CStringDataSource>( "<?xml version='1.0' encoding='UTF-8'?>"
+                                                            "<osm version=\"0.6\" generator=\"osmconvert 0.8.5\">"
+                                                            "<node id=\"1\" lat=\"38.5\" lon=\"-121.7\"/>"
+                                                            "<node id=\"2\" lat=\"38.6\" lon=\"-121.7\"/>"
+                                                            "<node id=\"3\" lat=\"38.6\" lon=\"-121.8\"/>"
+                                                            "<node id=\"4\" lat=\"38.5\" lon=\"-121.8\"/>"
+                                                            "<way id=\"10\">"
+                                                            "<nd ref=\"3\"/>"
+                                                            "<nd ref=\"4\"/>"
+                                                            "</way>"
+                                                            "</osm>");
+    // stop IDs differ from node IDs, and no street joins the stops so only
+    // the bus gets between them
+    auto InStreamStops = std::make_shared<CStringDataSource>("stop_id,node_id\n"
+                                                            "201,1\n"
+                                                            "202,2\n"
+                                                            "203,3");
+    auto InStreamRoutes = std::make_shared<CStringDataSource>("route,stop_id\n"
+                                                             "X,201\n"
+                                                             "X,202\n"
+                                                             "X,203");
+    auto XMLReader = std::make_shared<CXMLReader>(InStreamOSM);
+    auto CSVReaderStops = std::make_shared<CDSVReader>(InStreamStops,',');
+    auto CSVReaderRoutes = std::make_shared<CDSVReader>(InStreamRoutes,',');
+    auto StreetMap = std::make_shared<COpenStreetMap>(XMLReader);
+    auto BusSystem = std::make_shared<CCSVBusSystem>(CSVReaderStops, CSVReaderRoutes);
+    auto Config = std::make_shared<STransportationPlannerConfig>(StreetMap,BusSystem);
+    CDijkstraTransportationPlanner Planner(Config);
+
+    const double StopTime = 30.0 / 3600.0;
+    double FirstRide = SGeographicUtils::HaversineDistanceInMiles(std::make_pair(38.5,-121.7),std::make_pair(38.6,-121.7)) / 25.0;
+    double SecondRide = SGeographicUtils::HaversineDistanceInMiles(std::make_pair(38.6,-121.7),std::make_pair(38.6,-121.8)) / 25.0;
+    double LastWalk = SGeographicUtils::HaversineDistanceInMiles(std::make_pair(38.6,-121.8),std::make_pair(38.5,-121.8)) / 3.0;
+    for(auto Strategy : {CDijkstraTransportationPlanner::ESearchStrategy::Dijkstra, CDijkstraTransportationPlanner::ESearchStrategy::AStar, CDijkstraTransportationPlanner::ESearchStrategy::Raptor}){
+        Planner.SetSearchStrategy(Strategy);
+        std::vector< CTransportationPlanner::TTripStep > OneStopPath, ThroughPath, WalkOnPath, BackwardPath;
+        EXPECT_NEAR(Planner.FindFastestPath(1,2,OneStopPath),StopTime + FirstRide,1e-12);
+        EXPECT_EQ(OneStopPath,std::vector< CTransportationPlanner::TTripStep >({{CTransportationPlanner::ETransportationMode::Walk,1},
+                                                                                {CTransportationPlanner::ETransportationMode::Bus,2}}));
+        EXPECT_NEAR(Planner.FindFastestPath(1,3,ThroughPath),2 * StopTime + FirstRide + SecondRide,1e-12);
+        EXPECT_EQ(ThroughPath,std::vector< CTransportationPlanner::TTripStep >({{CTransportationPlanner::ETransportationMode::Walk,1},
+                                                                                {CTransportationPlanner::ETransportationMode::Bus,2},
+                                                                                {CTransportationPlanner::ETransportationMode::Bus,3}}));
+        EXPECT_NEAR(Planner.FindFastestPath(1,4,WalkOnPath),2 * StopTime + FirstRide + SecondRide + LastWalk,1e-12);
+        EXPECT_EQ(WalkOnPath,std::vector< CTransportationPlanner::TTripStep >({{CTransportationPlanner::ETransportationMode::Walk,1},
+                                                                                {CTransportationPlanner::ETransportationMode::Bus,2},
+                                                                                {CTransportationPlanner::ETransportationMode::Bus,3},
+                                                                                {CTransportationPlanner::ETransportationMode::Walk,4}}));
+        EXPECT_EQ(Planner.FindFastestPath(3,1,BackwardPath),CPathRouter::NoPathExists);
+        EXPECT_TRUE(BackwardPath.empty());
+    }
+}
+
+TEST(CSVOSMTransporationPlanner, RaptorTest){
+    auto InStreamOSM = std::make_shared<CStringDataSource>( "<?xml version='1.0' encoding='UTF-8'?>"
+                                                            "<osm version=\"0.6\" generator=\"osmconvert 0.8.5\">"
+                                                            "<node id=\"1\" lat=\"38.5\" lon=\"-121.7\"/>"
+                                                            "<node id=\"2\" lat=\"38.6\" lon=\"-121.7\"/>"
+                                                            "<node id=\"3\" lat=\"38.6\" lon=\"-121.705\"/>"
+                                                            "<node id=\"4\" lat=\"38.7\" lon=\"-121.705\"/>"
+                                                            "<node id=\"5\" lat=\"38.7\" lon=\"-121.72\"/>"
+                                                            "<way id=\"10\">"
+                                                            "<nd ref=\"2\"/>"
+                                                            "<nd ref=\"3\"/>"
+                                                            "</way>"
+                                                            "<way id=\"11\">"
+                                                            "<nd ref=\"4\"/>"
+                                                            "<nd ref=\"5\"/>"
+                                                            "</way>"
+                                                            "</osm>");
+    // getting from 1 to 5 takes both routes and the walk between them
+    auto InStreamStops = std::make_shared<CStringDataSource>("stop_id,node_id\n"
+                                                            "201,1\n"
+                                                            "202,2\n"
+                                                            "203,3\n"
+                                                            "204,4");
+    auto InStreamRoutes = std::make_shared<CStringDataSource>("route,stop_id\n"
+                                                             "X,201\n"
+                                                             "X,202\n"
+                                                             "Y,203\n"
+                                                             "Y,204");
+    auto XMLReader = std::make_shared<CXMLReader>(InStreamOSM);
+    auto CSVReaderStops = std::make_shared<CDSVReader>(InStreamStops,',');
+    auto CSVReaderRoutes = std::make_shared<CDSVReader>(InStreamRoutes,',');
+    auto StreetMap = std::make_shared<COpenStreetMap>(XMLReader);
+    auto BusSystem = std::make_shared<CCSVBusSystem>(CSVReaderStops, CSVReaderRoutes);
+    auto Config = std::make_shared<STransportationPlannerConfig>(StreetMap,BusSystem);
+    CDijkstraTransportationPlanner Planner(Config);
+
+    Planner.SetSearchStrategy(CDijkstraTransportationPlanner::ESearchStrategy::Raptor);
+    EXPECT_EQ(Planner.SearchStrategy(),CDijkstraTransportationPlanner::ESearchStrategy::Raptor);
+    std::vector< CTransportationPlanner::TTripStep > RaptorPath, DijkstraPath;
+    double RaptorTime = Planner.FindFastestPath(1,5,RaptorPath);
+    EXPECT_EQ(RaptorPath,std::vector< CTransportationPlanner::TTripStep >({{CTransportationPlanner::ETransportationMode::Walk,1},
+                                                                            {CTransportationPlanner::ETransportationMode::Bus,2},
+                                                                            {CTransportationPlanner::ETransportationMode::Walk,3},
+                                                                            {CTransportationPlanner::ETransportationMode::Bus,4},
+                                                                            {CTransportationPlanner::ETransportationMode::Walk,5}}));
+    Planner.SetSearchStrategy(CDijkstraTransportationPlanner::ESearchStrategy::Dijkstra);
+    EXPECT_NEAR(Planner.FindFastestPath(1,5,DijkstraPath),RaptorTime,1e-12);
+    EXPECT_EQ(DijkstraPath,RaptorPath);
+
+    // every pair of nodes gets the same answer from both searches
+    for(CStreetMap::TNodeID Src = 1; Src <= 5; Src++){
+        for(CStreetMap::TNodeID Dest = 1; Dest <= 5; Dest++){
+            Planner.SetSearchStrategy(CDijkstraTransportationPlanner::ESearchStrategy::Dijkstra);
+            double DijkstraTime = Planner.FindFastestPath(Src,Dest,DijkstraPath);
+            Planner.SetSearchStrategy(CDijkstraTransportationPlanner::ESearchStrategy::Raptor);
+            if(DijkstraTime == CPathRouter::NoPathExists){
+                EXPECT_EQ(Planner.FindFastestPath(Src,Dest,RaptorPath),CPathRouter::NoPathExists);
+            }
+            else{
+                EXPECT_NEAR(Planner.FindFastestPath(Src,Dest,RaptorPath),DijkstraTime,1e-12);
+            }
+            EXPECT_EQ(RaptorPath,DijkstraPath);
+        }
+    }
+}
+
+TEST(CSVOSMTransporationPlanner, PathOptionsTest){
+    auto InStreamOSM = std::make_shared<CStringDataSource>( "<?xml version='1.0' encoding='UTF-8'?>"
+                                                            "<osm version=\"0.6\" generator=\"osmconvert 0.8.5\">"
+                                                            "<node id=\"1\" lat=\"38.5\" lon=\"-121.7\"/>"
+                                                            "<node id=\"2\" lat=\"38.6\" lon=\"-121.7\"/>"
+                                                            "<node id=\"3\" lat=\"38.6\" lon=\"-121.71\"/>"
+                                                            "<way id=\"10\">"
+                                                            "<nd ref=\"2\"/>"
+                                                            "<nd ref=\"3\"/>"
+                                                            "</way>"
+                                                            "</osm>");
+    // from 2 the rider either walks to 3 or transfers to Y, which is slower
+    // but takes no walking
+    auto InStreamStops = std::make_shared<CStringDataSource>("stop_id,node_id\n"
+                                                            "201,1\n"
+                                                            "202,2\n"
+                                                            "203,3");
+    auto InStreamRoutes = std::make_shared<CStringDataSource>("route,stop_id\n"
+                                                             "X,201\n"
+                                                             "X,202\n"
+                                                             "Y,202\n"
+                                                             "Y,203");
+    auto XMLReader = std::make_shared<CXMLReader>(InStreamOSM);
+    auto CSVReaderStops = std::make_shared<CDSVReader>(InStreamStops,',');
+    auto CSVReaderRoutes = std::make_shared<CDSVReader>(InStreamRoutes,',');
+    auto StreetMap = std::make_shared<COpenStreetMap>(XMLReader);
+    auto BusSystem = std::make_shared<CCSVBusSystem>(CSVReaderStops, CSVReaderRoutes);
+    auto Config = std::make_shared<STransportationPlannerConfig>(StreetMap,BusSystem);
+    CDijkstraTransportationPlanner Planner(Config);
+
+    const double StopTime = 30.0 / 3600.0;
+    double Ride = SGeographicUtils::HaversineDistanceInMiles(std::make_pair(38.5,-121.7),std::make_pair(38.6,-121.7)) / 25.0;
+    double Street = SGeographicUtils::HaversineDistanceInMiles(std::make_pair(38.6,-121.7),std::make_pair(38.6,-121.71));
+    double Walk = Street / 3.0;
+    auto Options = Planner.FindFastestPathOptions(1,3);
+    ASSERT_EQ(Options.size(),2);
+    EXPECT_NEAR(Options[0].DTime,StopTime + Ride + Walk,1e-12);
+    EXPECT_EQ(Options[0].DRides,1);
+    EXPECT_NEAR(Options[0].DWalkTime,Walk,1e-12);
+    EXPECT_EQ(Options[0].DPath,std::vector< CTransportationPlanner::TTripStep >({{CTransportationPlanner::ETransportationMode::Walk,1},
+                                                                                 {CTransportationPlanner::ETransportationMode::Bus,2},
+                                                                                 {CTransportationPlanner::ETransportationMode::Walk,3}}));
+    EXPECT_NEAR(Options[1].DTime,StopTime + Ride + StopTime + Street / 25.0,1e-12);
+    EXPECT_EQ(Options[1].DRides,2);
+    EXPECT_EQ(Options[1].DWalkTime,0.0);
+    EXPECT_EQ(Options[1].DPath,std::vector< CTransportationPlanner::TTripStep >({{CTransportationPlanner::ETransportationMode::Walk,1},
+                                                                                 {CTransportationPlanner::ETransportationMode::Bus,2},
+                                                                                 {CTransportationPlanner::ETransportationMode::Bus,3}}));
+    for(const auto &Option : Options){
+        std::vector< std::string > Description;
+        EXPECT_TRUE(Planner.GetPathDescription(Option.DPath,Description));
+        EXPECT_FALSE(Description.empty());
+    }
+
+    // biking all the way beats walking and is the option with no rides,
+    // unreachable nodes have none
+    Options = Planner.FindFastestPathOptions(2,3);
+    ASSERT_EQ(Options.size(),2);
+    EXPECT_EQ(Options[0].DRides,0);
+    EXPECT_NEAR(Options[0].DTime,Street / 8.0,1e-12);
+    EXPECT_EQ(Options[0].DWalkTime,0.0);
+    EXPECT_EQ(Options[0].DPath,std::vector< CTransportationPlanner::TTripStep >({{CTransportationPlanner::ETransportationMode::Bike,2},
+                                                                                 {CTransportationPlanner::ETransportationMode::Bike,3}}));
+    EXPECT_EQ(Options[1].DRides,1);
+    EXPECT_NEAR(Options[1].DTime,StopTime + Street / 25.0,1e-12);
+    EXPECT_EQ(Options[1].DWalkTime,0.0);
+    EXPECT_TRUE(Planner.FindFastestPathOptions(3,1).empty());
+    EXPECT_TRUE(Planner.FindFastestPathOptions(1,4).empty());
+
+    // the fastest option matches the fastest path
+    for(CStreetMap::TNodeID Src = 1; Src <= 3; Src++){
+        for(CStreetMap::TNodeID Dest = 1; Dest <= 3; Dest++){
+            std::vector< CTransportationPlanner::TTripStep > Path;
+            double Time = Planner.FindFastestPath(Src,Dest,Path);
+            Options = Planner.FindFastestPathOptions(Src,Dest);
+            if(Time == CPathRouter::NoPathExists){
+                EXPECT_TRUE(Options.empty());
+            }
+            else{
+                ASSERT_FALSE(Options.empty());
+                auto Fastest = std::min_element(Options.begin(),Options.end(),[](const auto &Left, const auto &Right){
+                    return Left.DTime < Right.DTime;
+                });
+                EXPECT_NEAR(Fastest->DTime,Time,1e-12);
+                EXPECT_EQ(Fastest->DPath,Path);
+            }
+        }
+    }
+}
+
+TEST(CSVOSMTransporationPlanner, LayeredGraphTest){
+    auto InStreamOSM = std::make_shared<CStringDataSource>( "<?xml version='1.0' encoding='UTF-8'?>"
+                                                            "<osm version=\"0.6\" generator=\"osmconvert 0.8.5\">"
+                                                            "<node id=\"1\" lat=\"38.5\" lon=\"-121.7\"/>"
+                                                            "<node id=\"2\" lat=\"38.51\" lon=\"-121.7\"/>"
+                                                            "<node id=\"3\" lat=\"38.51\" lon=\"-121.71\"/>"
+                                                            "<way id=\"10\">"
+                                                            "<nd ref=\"1\"/>"
+                                                            "<nd ref=\"2\"/>"
+                                                            "<tag k=\"oneway\" v=\"yes\"/>"
+                                                            "</way>"
+                                                            "<way id=\"11\">"
+                                                            "<nd ref=\"3\"/>"
+                                                            "<nd ref=\"2\"/>"
+                                                            "</way>"
+                                                            "</osm>");
+    auto XMLReader = std::make_shared<CXMLReader>(InStreamOSM);
+    auto StreetMap = std::make_shared<COpenStreetMap>(XMLReader);
+    // without a bus system riders still walk and bike
+    auto Config = std::make_shared<STransportationPlannerConfig>(StreetMap,nullptr);
+    CDijkstraTransportationPlanner Planner(Config);
+
+    double FirstStreet = SGeographicUtils::HaversineDistanceInMiles(std::make_pair(38.5,-121.7),std::make_pair(38.51,-121.7));
+    double SecondStreet = SGeographicUtils::HaversineDistanceInMiles(std::make_pair(38.51,-121.7),std::make_pair(38.51,-121.71));
+    for(auto Strategy : {CDijkstraTransportationPlanner::ESearchStrategy::Dijkstra, CDijkstraTransportationPlanner::ESearchStrategy::AStar, CDijkstraTransportationPlanner::ESearchStrategy::Raptor}){
+        Planner.SetSearchStrategy(Strategy);
+        std::vector< CTransportationPlanner::TTripStep > ForwardPath, BackwardPath;
+        // cyclists follow the oneway street and ride the other one against its node order
+        EXPECT_NEAR(Planner.FindFastestPath(1,3,ForwardPath),(FirstStreet + SecondStreet) / 8.0,1e-12);
+        EXPECT_EQ(ForwardPath,std::vector< CTransportationPlanner::TTripStep >({{CTransportationPlanner::ETransportationMode::Bike,1},
+                                                                                 {CTransportationPlanner::ETransportationMode::Bike,2},
+                                                                                 {CTransportationPlanner::ETransportationMode::Bike,3}}));
+        // pedestrians walk against the oneway street
+        EXPECT_NEAR(Planner.FindFastestPath(3,1,BackwardPath),(SecondStreet + FirstStreet) / 3.0,1e-12);
+        EXPECT_EQ(BackwardPath,std::vector< CTransportationPlanner::TTripStep >({{CTransportationPlanner::ETransportationMode::Walk,3},
+                                                                                  {CTransportationPlanner::ETransportationMode::Walk,2},
+                                                                                  {CTransportationPlanner::ETransportationMode::Walk,1}}));
+    }
+    auto Options = Planner.FindFastestPathOptions(3,1);
+    ASSERT_EQ(Options.size(),1);
+    EXPECT_EQ(Options[0].DRides,0);
+    EXPECT_NEAR(Options[0].DWalkTime,(SecondStreet + FirstStreet) / 3.0,1e-12);
+}
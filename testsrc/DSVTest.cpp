@@ -2,7 +2,10 @@
 #include "DSVWriter.h"
 #include "StringDataSource.h"
 #include "StringDataSink.h"
+#include "MemoryMappedDataSource.h"
 #include <gtest/gtest.h>
+#include <filesystem>
+#include <fstream>
 
 TEST(DSVTest, BasicReadWrite) {
     // initialize a shared pointer for data w/ DSV content
@@ -27,3 +30,122 @@ TEST(DSVTest, BasicReadWrite) {
     EXPECT_EQ(sink->String(), "hello,anikaandaleena,hi\na,b,c\n");
 }
 
+
+TEST(DSVTest, ViewRowTest) {
+    auto src = std::make_shared<CStringDataSource>("1,\"a,b\",\"say \"\"hi\"\"\"\r\n\n-7,2.5,x\n");
+    CDSVReader reader(src, ',');
+    std::vector<std::string_view> row;
+
+    ASSERT_TRUE(reader.ReadRow(row));
+    ASSERT_EQ(row.size(), 3);
+    EXPECT_EQ(row[0], "1");
+    EXPECT_EQ(row[1], "a,b");
+    EXPECT_EQ(row[2], "say \"hi\"");
+    EXPECT_EQ(reader.FieldCount(), 3);
+    EXPECT_EQ(reader.Field(2), row[2]);
+    unsigned long id = 0;
+    EXPECT_TRUE(reader.Field(0, id));
+    EXPECT_EQ(id, 1);
+    EXPECT_FALSE(reader.Field(1, id));
+    EXPECT_FALSE(reader.Field(3, id));
+
+    // a blank line is a row without fields
+    ASSERT_TRUE(reader.ReadRow(row));
+    EXPECT_TRUE(row.empty());
+
+    ASSERT_TRUE(reader.ReadRow(row));
+    int negative = 0;
+    double fraction = 0;
+    EXPECT_TRUE(reader.Field(0, negative));
+    EXPECT_EQ(negative, -7);
+    EXPECT_FALSE(reader.Field(0, id));
+    EXPECT_TRUE(reader.Field(1, fraction));
+    EXPECT_EQ(fraction, 2.5);
+    EXPECT_FALSE(reader.Field(1, negative));
+    EXPECT_EQ(reader.Field(2), "x");
+
+    EXPECT_TRUE(reader.End());
+    EXPECT_FALSE(reader.ReadRow(row));
+    EXPECT_TRUE(row.empty());
+}
+
+TEST(DSVTest, LargeInputTest) {
+    // enough rows that some of them straddle the chunks read from the source
+    std::string data;
+    for (int index = 0; index < 20000; index++) {
+        data += std::to_string(index) + ",\"name " + std::to_string(index) + "\"\"\",tail\n";
+    }
+    CDSVReader viewreader(std::make_shared<CStringDataSource>(data), ',');
+    CDSVReader stringreader(std::make_shared<CStringDataSource>(data), ',');
+    std::vector<std::string_view> viewrow;
+    std::vector<std::string> stringrow;
+    int count = 0;
+    while (viewreader.ReadRow(viewrow)) {
+        ASSERT_TRUE(stringreader.ReadRow(stringrow));
+        ASSERT_EQ(viewrow.size(), 3);
+        ASSERT_EQ(stringrow.size(), 3);
+        int value = -1;
+        EXPECT_TRUE(viewreader.Field(0, value));
+        EXPECT_EQ(value, count);
+        EXPECT_EQ(viewrow[1], "name " + std::to_string(count) + "\"");
+        EXPECT_EQ(stringrow[1], viewrow[1]);
+        EXPECT_EQ(viewrow[2], "tail");
+        count++;
+    }
+    EXPECT_EQ(count, 20000);
+    EXPECT_FALSE(stringreader.ReadRow(stringrow));
+}
+
+TEST(DSVTest, BlockBoundaryTest) {
+    // puts quotes, separators and line breaks at every offset within the
+    // blocks the scanner tests at once
+    std::string data;
+    std::vector<std::vector<std::string>> expected;
+    for (std::size_t length = 1; length < 70; length++) {
+        std::string plain(length, 'p');
+        std::string quoted = std::string(length, 'q') + "\"" + std::string(length % 7, 'r');
+        data += plain + ",\"" + std::string(length, 'q') + "\"\"" + std::string(length % 7, 'r') + "\";" + plain + (length % 2 ? "\r\n" : "\n");
+        expected.push_back({plain, quoted + ";" + plain});
+    }
+    CDSVReader reader(std::make_shared<CStringDataSource>(data), ',');
+    std::vector<std::string> row;
+    for (const auto &expectedrow : expected) {
+        ASSERT_TRUE(reader.ReadRow(row));
+        EXPECT_EQ(row, expectedrow);
+    }
+    EXPECT_FALSE(reader.ReadRow(row));
+}
+
+TEST(DSVTest, ParallelTest) {
+    // several megabytes so the file is split, with quoted line breaks and
+    // both kinds of line ending so the split has to find real row starts
+    std::string data = "id,name,notes\n";
+    for (int index = 0; index < 200000; index++) {
+        data += std::to_string(index) + ",\"stop\n" + std::to_string(index) + "\",\"said \"\"hi\"\"\r\nthere\"" + (index % 3 ? "\r\n" : "\n");
+        if (index % 1000 == 0) {
+            data += "\n";
+        }
+    }
+    data += "last,row";
+    const std::string filename = (std::filesystem::temp_directory_path() / "DSVTestParallel.csv").string();
+    std::ofstream(filename, std::ios::binary) << data;
+
+    CDSVReader sequential(std::make_shared<CStringDataSource>(data), ',');
+    CDSVReader parallel(std::make_shared<CMemoryMappedDataSource>(filename), ',', 4);
+    std::filesystem::remove(filename);
+    std::vector<std::string> expected;
+    std::vector<std::string_view> row;
+    std::size_t count = 0;
+    while (sequential.ReadRow(expected)) {
+        EXPECT_FALSE(parallel.End());
+        ASSERT_TRUE(parallel.ReadRow(row));
+        ASSERT_EQ(row.size(), expected.size());
+        for (std::size_t index = 0; index < row.size(); index++) {
+            EXPECT_EQ(row[index], expected[index]);
+        }
+        count++;
+    }
+    EXPECT_EQ(count, 200202);
+    EXPECT_TRUE(parallel.End());
+    EXPECT_FALSE(parallel.ReadRow(row));
+}
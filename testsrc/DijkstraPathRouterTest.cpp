@@ -0,0 +1,289 @@
+#include <gtest/gtest.h>
+#include "DijkstraPathRouter.h"
+#include "SnapshotReader.h"
+#include "SnapshotWriter.h"
+#include "FileDataSink.h"
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+
+TEST(DijkstraPathRouter, SimpleTest){
+    CDijkstraPathRouter PathRouter;
+
+    EXPECT_EQ(PathRouter.VertexCount(),0);
+    auto VertexID = PathRouter.AddVertex(std::string("Hello"));
+    EXPECT_EQ(PathRouter.VertexCount(),1);
+    EXPECT_EQ(std::any_cast<std::string>(PathRouter.GetVertexTag(VertexID)),"Hello");
+    EXPECT_FALSE(PathRouter.GetVertexTag(VertexID + 1).has_value());
+    EXPECT_FALSE(PathRouter.AddEdge(VertexID,VertexID + 1,1.0));
+    EXPECT_FALSE(PathRouter.AddEdge(VertexID,VertexID,-1.0));
+}
+
+TEST(DijkstraPathRouter, ShortestPathTest){
+    CDijkstraPathRouter PathRouter;
+    std::vector<CPathRouter::TVertexID> Vertices;
+    for(std::size_t Index = 0; Index < 6; Index++){
+        Vertices.push_back(PathRouter.AddVertex(Index));
+    }
+    // 0 -> 1 -> 2 -> 5 costs 3, 0 -> 3 -> 4 -> 5 costs 6
+    EXPECT_TRUE(PathRouter.AddEdge(Vertices[0],Vertices[1],1.0));
+    EXPECT_TRUE(PathRouter.AddEdge(Vertices[1],Vertices[2],1.0));
+    EXPECT_TRUE(PathRouter.AddEdge(Vertices[2],Vertices[5],1.0));
+    EXPECT_TRUE(PathRouter.AddEdge(Vertices[0],Vertices[3],2.0,true));
+    EXPECT_TRUE(PathRouter.AddEdge(Vertices[3],Vertices[4],2.0));
+    EXPECT_TRUE(PathRouter.AddEdge(Vertices[4],Vertices[5],2.0));
+    // 3 -> 0 -> 1 -> 2 -> 5 costs 5, 3 -> 4 -> 5 costs 4
+    std::vector<CPathRouter::TVertexID> Path, ExpectedPath = {0,1,2,5};
+    EXPECT_EQ(PathRouter.FindShortestPath(Vertices[0],Vertices[5],Path),3.0);
+    EXPECT_EQ(Path,ExpectedPath);
+    ExpectedPath = {3,4,5};
+    EXPECT_EQ(PathRouter.FindShortestPath(Vertices[3],Vertices[5],Path),4.0);
+    EXPECT_EQ(Path,ExpectedPath);
+    EXPECT_EQ(PathRouter.FindShortestPath(Vertices[5],Vertices[0],Path),CPathRouter::NoPathExists);
+    EXPECT_TRUE(Path.empty());
+}
+
+TEST(DijkstraPathRouter, AddEdgeAfterQueryTest){
+    CDijkstraPathRouter PathRouter;
+    for(std::size_t Index = 0; Index < 4; Index++){
+        PathRouter.AddVertex(Index);
+    }
+    PathRouter.AddEdge(0,1,5.0);
+    PathRouter.AddEdge(1,2,5.0);
+    std::vector<CPathRouter::TVertexID> Path, ExpectedPath = {0,1,2};
+    EXPECT_EQ(PathRouter.FindShortestPath(0,2,Path),10.0);
+    EXPECT_EQ(Path,ExpectedPath);
+    // Edges added once the graph is frozen must still be used
+    auto NewVertex = PathRouter.AddVertex(std::size_t(4));
+    PathRouter.AddEdge(0,NewVertex,1.0);
+    PathRouter.AddEdge(NewVertex,2,1.0);
+    ExpectedPath = {0,4,2};
+    EXPECT_EQ(PathRouter.FindShortestPath(0,2,Path),2.0);
+    EXPECT_EQ(Path,ExpectedPath);
+    // Re-adding an edge replaces its weight
+    PathRouter.AddEdge(1,2,0.5);
+    PathRouter.AddEdge(0,1,0.5);
+    ExpectedPath = {0,1,2};
+    EXPECT_EQ(PathRouter.FindShortestPath(0,2,Path),1.0);
+    EXPECT_EQ(Path,ExpectedPath);
+    EXPECT_TRUE(PathRouter.Precompute(std::chrono::steady_clock::now() + std::chrono::seconds(1)));
+    EXPECT_EQ(PathRouter.FindShortestPath(0,2,Path),1.0);
+    EXPECT_EQ(Path,ExpectedPath);
+    EXPECT_EQ(PathRouter.FindShortestPath(3,2,Path),CPathRouter::NoPathExists);
+}
+
+TEST(DijkstraPathRouter, PrecomputeTest){
+    CDijkstraPathRouter PlainRouter, PrecomputedRouter, LateRouter;
+    const std::size_t GridSize = 12;
+    for(std::size_t Index = 0; Index < GridSize * GridSize; Index++){
+        PlainRouter.AddVertex(Index);
+        PrecomputedRouter.AddVertex(Index);
+        LateRouter.AddVertex(Index);
+    }
+    // Grid with a mix of one way and two way streets of varying weights
+    for(std::size_t Row = 0; Row < GridSize; Row++){
+        for(std::size_t Col = 0; Col < GridSize; Col++){
+            auto Vertex = Row * GridSize + Col;
+            double Weight = 1.0 + double((Row * 7 + Col * 13) % 5);
+            bool Bidirectional = (Row + Col) % 3 != 0;
+            if(Col + 1 < GridSize){
+                PlainRouter.AddEdge(Vertex,Vertex + 1,Weight,Bidirectional);
+                PrecomputedRouter.AddEdge(Vertex,Vertex + 1,Weight,Bidirectional);
+                LateRouter.AddEdge(Vertex,Vertex + 1,Weight,Bidirectional);
+            }
+            if(Row + 1 < GridSize){
+                PlainRouter.AddEdge(Vertex,Vertex + GridSize,Weight + 0.5,!Bidirectional);
+                PrecomputedRouter.AddEdge(Vertex,Vertex + GridSize,Weight + 0.5,!Bidirectional);
+                LateRouter.AddEdge(Vertex,Vertex + GridSize,Weight + 0.5,!Bidirectional);
+            }
+        }
+    }
+    EXPECT_TRUE(PrecomputedRouter.Precompute(std::chrono::steady_clock::now() + std::chrono::seconds(10)));
+    // A deadline that already passed leaves plain Dijkstra in place
+    EXPECT_FALSE(LateRouter.Precompute(std::chrono::steady_clock::now() - std::chrono::seconds(1)));
+    for(std::size_t Source = 0; Source < GridSize * GridSize; Source += 5){
+        for(std::size_t Dest = 0; Dest < GridSize * GridSize; Dest += 3){
+            std::vector<CPathRouter::TVertexID> PlainPath, PrecomputedPath, LatePath;
+            double PlainDistance = PlainRouter.FindShortestPath(Source,Dest,PlainPath);
+            double PrecomputedDistance = PrecomputedRouter.FindShortestPath(Source,Dest,PrecomputedPath);
+            EXPECT_DOUBLE_EQ(PrecomputedDistance,PlainDistance);
+            EXPECT_EQ(LateRouter.FindShortestPath(Source,Dest,LatePath),PlainDistance);
+            if(PlainDistance != CPathRouter::NoPathExists){
+                ASSERT_FALSE(PrecomputedPath.empty());
+                EXPECT_EQ(PrecomputedPath.front(),Source);
+                EXPECT_EQ(PrecomputedPath.back(),Dest);
+                // Verify the unpacked path only uses original edges
+                double PathDistance = 0.0;
+                for(std::size_t Index = 1; Index < PrecomputedPath.size(); Index++){
+                    std::vector<CPathRouter::TVertexID> EdgePath;
+                    PathDistance += PlainRouter.FindShortestPath(PrecomputedPath[Index-1],PrecomputedPath[Index],EdgePath);
+                    EXPECT_EQ(EdgePath.size(),2);
+                }
+                EXPECT_DOUBLE_EQ(PathDistance,PlainDistance);
+            }
+        }
+    }
+    // Adding an edge invalidates the hierarchy until the next precompute
+    PrecomputedRouter.AddEdge(0,GridSize * GridSize - 1,0.25);
+    std::vector<CPathRouter::TVertexID> Path, ExpectedPath = {0,GridSize * GridSize - 1};
+    EXPECT_EQ(PrecomputedRouter.FindShortestPath(0,GridSize * GridSize - 1,Path),0.25);
+    EXPECT_EQ(Path,ExpectedPath);
+    EXPECT_TRUE(PrecomputedRouter.Precompute(std::chrono::steady_clock::now() + std::chrono::seconds(10)));
+    EXPECT_EQ(PrecomputedRouter.FindShortestPath(0,GridSize * GridSize - 1,Path),0.25);
+    EXPECT_EQ(Path,ExpectedPath);
+}
+
+TEST(DijkstraPathRouter, BidirectionalTest){
+    CDijkstraPathRouter PlainRouter, BidirectionalRouter;
+    const std::size_t GridSize = 20;
+    for(std::size_t Index = 0; Index < GridSize * GridSize; Index++){
+        PlainRouter.AddVertex(Index);
+        BidirectionalRouter.AddVertex(Index);
+    }
+    PlainRouter.SetSearchMode(CDijkstraPathRouter::ESearchMode::Dijkstra);
+    BidirectionalRouter.SetSearchMode(CDijkstraPathRouter::ESearchMode::Bidirectional);
+    EXPECT_EQ(BidirectionalRouter.SearchMode(),CDijkstraPathRouter::ESearchMode::Bidirectional);
+    for(std::size_t Row = 0; Row < GridSize; Row++){
+        for(std::size_t Col = 0; Col < GridSize; Col++){
+            auto Vertex = Row * GridSize + Col;
+            double Weight = 1.0 + double((Row * 7 + Col * 13) % 5);
+            bool Bidirectional = (Row + Col) % 4 != 0;
+            if(Col + 1 < GridSize){
+                PlainRouter.AddEdge(Vertex,Vertex + 1,Weight,Bidirectional);
+                BidirectionalRouter.AddEdge(Vertex,Vertex + 1,Weight,Bidirectional);
+            }
+            if(Row + 1 < GridSize){
+                PlainRouter.AddEdge(Vertex,Vertex + GridSize,Weight + 0.5,true);
+                BidirectionalRouter.AddEdge(Vertex,Vertex + GridSize,Weight + 0.5,true);
+            }
+        }
+    }
+    for(std::size_t Source = 0; Source < GridSize * GridSize; Source += 7){
+        for(std::size_t Dest = 0; Dest < GridSize * GridSize; Dest += 11){
+            std::vector<CPathRouter::TVertexID> PlainPath, BidirectionalPath;
+            double PlainDistance = PlainRouter.FindShortestPath(Source,Dest,PlainPath);
+            EXPECT_EQ(BidirectionalRouter.FindShortestPath(Source,Dest,BidirectionalPath),PlainDistance);
+            ASSERT_FALSE(BidirectionalPath.empty());
+            EXPECT_EQ(BidirectionalPath.front(),Source);
+            EXPECT_EQ(BidirectionalPath.back(),Dest);
+        }
+    }
+    // Meeting in the middle settles fewer vertices corner to corner
+    std::vector<CPathRouter::TVertexID> Path;
+    PlainRouter.FindShortestPath(0,GridSize * GridSize - 1,Path);
+    BidirectionalRouter.FindShortestPath(0,GridSize * GridSize - 1,Path);
+    EXPECT_LT(BidirectionalRouter.SettledVertexCount(),PlainRouter.SettledVertexCount());
+    // Edges added after the first query are searched in both directions
+    BidirectionalRouter.AddEdge(0,GridSize * GridSize - 1,0.25);
+    std::vector<CPathRouter::TVertexID> ExpectedPath = {0,GridSize * GridSize - 1};
+    EXPECT_EQ(BidirectionalRouter.FindShortestPath(0,GridSize * GridSize - 1,Path),0.25);
+    EXPECT_EQ(Path,ExpectedPath);
+}
+
+TEST(DijkstraPathRouter, SnapshotTest){
+    const std::string Filename = (std::filesystem::temp_directory_path() / "DijkstraPathRouterSnapshot.bin").string();
+    CDijkstraPathRouter PathRouter, LoadedRouter, SmallRouter;
+    const std::size_t GridSize = 8;
+    for(std::size_t Index = 0; Index < GridSize * GridSize; Index++){
+        PathRouter.AddVertex(Index);
+        LoadedRouter.AddVertex(Index);
+    }
+    SmallRouter.AddVertex(std::size_t(0));
+    for(std::size_t Row = 0; Row < GridSize; Row++){
+        for(std::size_t Col = 0; Col + 1 < GridSize; Col++){
+            auto Vertex = Row * GridSize + Col;
+            PathRouter.AddEdge(Vertex,Vertex + 1,1.0 + double((Row + Col) % 3),Row % 2);
+            PathRouter.AddEdge(Col * GridSize + Row,(Col + 1) * GridSize + Row,1.5,true);
+        }
+    }
+    EXPECT_TRUE(PathRouter.Precompute(std::chrono::steady_clock::now() + std::chrono::seconds(10)));
+    {
+        CSnapshotWriter Writer(std::make_shared<CFileDataSink>(Filename),1);
+        EXPECT_TRUE(PathRouter.WriteSnapshot(Writer));
+        EXPECT_TRUE(Writer.Flush());
+    }
+    {
+        CSnapshotReader Reader(Filename);
+        ASSERT_TRUE(Reader.Valid());
+        EXPECT_EQ(Reader.Version(),1);
+        EXPECT_TRUE(LoadedRouter.ReadSnapshot(Reader));
+    }
+    for(std::size_t Source = 0; Source < GridSize * GridSize; Source += 3){
+        for(std::size_t Dest = 0; Dest < GridSize * GridSize; Dest += 5){
+            std::vector<CPathRouter::TVertexID> Path, LoadedPath;
+            EXPECT_EQ(LoadedRouter.FindShortestPath(Source,Dest,LoadedPath),PathRouter.FindShortestPath(Source,Dest,Path));
+            EXPECT_EQ(LoadedPath,Path);
+        }
+    }
+    // The vertex count must match the snapshot
+    CSnapshotReader Reader(Filename);
+    EXPECT_FALSE(SmallRouter.ReadSnapshot(Reader));
+    std::filesystem::remove(Filename);
+    EXPECT_FALSE(CSnapshotReader(Filename).Valid());
+}
+
+TEST(DijkstraPathRouter, DamagedSnapshotTest){
+    const std::string Filename = (std::filesystem::temp_directory_path() / "DijkstraPathRouterDamaged.bin").string();
+    const std::size_t GridSize = 8;
+    CDijkstraPathRouter PathRouter;
+    for(std::size_t Index = 0; Index < GridSize * GridSize; Index++){
+        PathRouter.AddVertex(Index);
+    }
+    for(std::size_t Row = 0; Row < GridSize; Row++){
+        for(std::size_t Col = 0; Col + 1 < GridSize; Col++){
+            auto Vertex = Row * GridSize + Col;
+            PathRouter.AddEdge(Vertex,Vertex + 1,1.0 + double((Row + Col) % 3),Row % 2);
+            PathRouter.AddEdge(Col * GridSize + Row,(Col + 1) * GridSize + Row,1.5,true);
+        }
+    }
+    EXPECT_TRUE(PathRouter.Precompute(std::chrono::steady_clock::now() + std::chrono::seconds(10)));
+    {
+        CSnapshotWriter Writer(std::make_shared<CFileDataSink>(Filename),1);
+        EXPECT_TRUE(PathRouter.WriteSnapshot(Writer));
+        EXPECT_TRUE(Writer.Flush());
+    }
+    auto FileSize = std::filesystem::file_size(Filename);
+    std::string Contents(FileSize,'\0');
+    std::ifstream(Filename,std::ios::binary).read(Contents.data(),FileSize);
+    auto Loads = [&](const std::string &Snapshot){
+        std::ofstream(Filename,std::ios::binary|std::ios::trunc).write(Snapshot.data(),Snapshot.size());
+        CDijkstraPathRouter LoadedRouter;
+        for(std::size_t Index = 0; Index < GridSize * GridSize; Index++){
+            LoadedRouter.AddVertex(Index);
+        }
+        CSnapshotReader Reader(Filename);
+        return LoadedRouter.ReadSnapshot(Reader);
+    };
+    EXPECT_TRUE(Loads(Contents));
+
+    // Arrays are 8 byte aligned, every weight is at least 1 and no other
+    // stored value reads as a double in that range. Every arc that is not a
+    // shortcut has an invalid middle 16 bytes after its vertex.
+    std::size_t Weights = 0, Middles = 0;
+    for(std::size_t Offset = 0; Offset + 8 <= FileSize; Offset += 8){
+        double Value;
+        uint64_t Raw;
+        std::memcpy(&Value,Contents.data() + Offset,8);
+        std::memcpy(&Raw,Contents.data() + Offset,8);
+        if(Value >= 1.0 && Value <= 1000.0){
+            for(double Damage : {-Value, std::numeric_limits<double>::quiet_NaN(), std::numeric_limits<double>::infinity()}){
+                std::string Damaged = Contents;
+                std::memcpy(Damaged.data() + Offset,&Damage,8);
+                EXPECT_FALSE(Loads(Damaged)) << "weight at " << Offset;
+            }
+            Weights++;
+        }
+        else if(Raw == CPathRouter::InvalidVertexID && Offset >= 16){
+            // a middle that is the arc's own end would unpack forever
+            std::string Damaged = Contents;
+            std::memcpy(Damaged.data() + Offset,Contents.data() + Offset - 16,8);
+            EXPECT_FALSE(Loads(Damaged)) << "middle at " << Offset;
+            Middles++;
+        }
+    }
+    EXPECT_GT(Weights,0);
+    EXPECT_GT(Middles,0);
+    std::filesystem::remove(Filename);
+}
@@ -3,6 +3,7 @@
 #include "FileDataSink.h"
 #include "FileDataSource.h"
 #include <cstdio>
+#include <filesystem>
 
 // Assume being run from Makefile so testtmp is subdirectory
 
@@ -55,3 +56,69 @@ TEST(FileDataSourceSink, WriteTest){
     EXPECT_EQ(InBuffer,OutBuffer);
     EXPECT_TRUE(Source->End());
 }
+
+TEST(FileDataSourceSink, LargeReadTest){
+    CFileDataFactory DataFactory(BaseDirectory);
+    std::string Filename = "large.txt";
+    std::remove((BaseDirectory + Filename).c_str());
+    std::vector<char> OutBuffer, InBuffer;
+    // several times the source block size so reads cross block boundaries
+    for(std::size_t Index = 0; Index < 200000; Index++){
+        OutBuffer.push_back(' ' + Index % 94);
+    }
+    {
+        auto Sink = DataFactory.CreateSink(Filename);
+        EXPECT_TRUE(Sink->Write(OutBuffer));
+    }
+    CFileDataSource Source(BaseDirectory + Filename);
+    char TempCh;
+    EXPECT_TRUE(Source.Peek(TempCh));
+    EXPECT_EQ(TempCh,OutBuffer[0]);
+    EXPECT_TRUE(Source.Get(TempCh));
+    EXPECT_EQ(TempCh,OutBuffer[0]);
+    EXPECT_TRUE(Source.Read(InBuffer,100000));
+    EXPECT_EQ(InBuffer,std::vector<char>(OutBuffer.begin() + 1,OutBuffer.begin() + 100001));
+    EXPECT_TRUE(Source.Get(TempCh));
+    EXPECT_EQ(TempCh,OutBuffer[100001]);
+    EXPECT_TRUE(Source.Read(InBuffer,OutBuffer.size()));
+    EXPECT_EQ(InBuffer,std::vector<char>(OutBuffer.begin() + 100002,OutBuffer.end()));
+    EXPECT_TRUE(Source.End());
+    EXPECT_FALSE(Source.Get(TempCh));
+    EXPECT_FALSE(Source.Read(InBuffer,1));
+}
+
+TEST(FileDataSourceSink, BufferedSinkTest){
+    std::string Filename = BaseDirectory + "buffered.txt";
+    std::remove(Filename.c_str());
+    std::vector<char> Small = {'a','b','c'};
+    std::vector<char> Large(100,'x');
+    {
+        CFileDataSink Sink(Filename,16);
+        EXPECT_EQ(Sink.Capacity(),16);
+        EXPECT_TRUE(Sink.Put('<'));
+        EXPECT_TRUE(Sink.Write(Small));
+        // nothing reaches the file until the buffer fills or is flushed
+        EXPECT_EQ(std::filesystem::file_size(Filename),0);
+        // too large for the buffer, goes out along with what is buffered
+        EXPECT_TRUE(Sink.Write(Large));
+        EXPECT_EQ(std::filesystem::file_size(Filename),104);
+        EXPECT_TRUE(Sink.Put('>'));
+        EXPECT_TRUE(Sink.Flush());
+        EXPECT_EQ(std::filesystem::file_size(Filename),105);
+        EXPECT_TRUE(Sink.Write(Small));
+    }
+    std::vector<char> Expected = {'<','a','b','c'};
+    Expected.insert(Expected.end(),Large.begin(),Large.end());
+    Expected.push_back('>');
+    Expected.insert(Expected.end(),Small.begin(),Small.end());
+    std::vector<char> InBuffer;
+    CFileDataSource Source(Filename);
+    EXPECT_TRUE(Source.Read(InBuffer,1000));
+    EXPECT_EQ(InBuffer,Expected);
+}
+
+TEST(FileDataSourceSink, BadSinkTest){
+    CFileDataSink Sink(BaseDirectory + "missing/dir/file.txt");
+    EXPECT_FALSE(Sink.Put('a'));
+    EXPECT_FALSE(Sink.Flush());
+}
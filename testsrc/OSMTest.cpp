@@ -3,6 +3,10 @@
 #include "StringUtils.h"
 #include "StringDataSource.h"
 #include "OpenStreetMap.h"
+#include "MemoryMappedDataSource.h"
+#include <filesystem>
+#include <fstream>
+#include <thread>
 
 TEST(OSMTest, SimpleTest){
     auto InStream = std::make_shared<CStringDataSource>("<?xml version='1.0' encoding='UTF-8'?>"
@@ -129,4 +133,320 @@ TEST(OSMTest, WayTest){
     EXPECT_EQ(TempWay->AttributeCount(),1);
     EXPECT_TRUE(TempWay->HasAttribute("oneway"));
     EXPECT_EQ(TempWay->GetAttribute("oneway"),"yes");
-}
\ No newline at end of file
+}
+TEST(OSMTest, LookupTest){
+    auto InStream = std::make_shared<CStringDataSource>("<?xml version='1.0' encoding='UTF-8'?>"
+                                                        "<osm version=\"0.6\" generator=\"osmconvert 0.8.5\">"
+                                                        "<node id=\"7\" lat=\"38.5\" lon=\"-121.7\"/>"
+                                                        "<node id=\"3\" lat=\"38.5\" lon=\"-121.71\"/>"
+                                                        "<way id=\"20\">"
+                                                        "<nd ref=\"7\"/>"
+                                                        "<nd ref=\"3\"/>"
+                                                        "</way>"
+                                                        "<way id=\"10\">"
+                                                        "<nd ref=\"3\"/>"
+                                                        "<nd ref=\"7\"/>"
+                                                        "</way>"
+                                                        "</osm>");
+    auto Reader = std::make_shared<CXMLReader>(InStream);
+    COpenStreetMap StreetMap(Reader);
+
+    EXPECT_EQ(StreetMap.NodeByID(7),StreetMap.NodeByIndex(0));
+    EXPECT_EQ(StreetMap.NodeByID(3),StreetMap.NodeByIndex(1));
+    EXPECT_EQ(StreetMap.WayByID(20),StreetMap.WayByIndex(0));
+    EXPECT_EQ(StreetMap.WayByID(10),StreetMap.WayByIndex(1));
+    EXPECT_FALSE(bool(StreetMap.NodeByID(1)));
+    EXPECT_FALSE(bool(StreetMap.WayByID(3)));
+}
+
+TEST(OSMTest, MappedFileTest){
+    const std::string Document = "<?xml version='1.0' encoding='UTF-8'?>"
+                                 "<osm version=\"0.6\" generator=\"osmconvert 0.8.5\">"
+                                 "<node id=\"1\" lat=\"38.5\" lon=\"-121.7\">"
+                                 "<tag k=\"foot\" v=\"yes\"/>"
+                                 "</node>"
+                                 "<node id=\"2\" lat=\"38.5\" lon=\"-121.71\"/>"
+                                 "<way id=\"100\">"
+                                 "<nd ref=\"1\"/>"
+                                 "<nd ref=\"2\"/>"
+                                 "<tag k=\"oneway\" v=\"yes\"/>"
+                                 "</way>"
+                                 "</osm>";
+    const std::string Filename = (std::filesystem::temp_directory_path() / "OSMTestMappedFile.osm").string();
+    std::ofstream(Filename) << Document;
+
+    auto Mapped = std::make_shared<CMemoryMappedDataSource>(Filename);
+    ASSERT_TRUE(Mapped->Valid());
+    COpenStreetMap MappedMap(Mapped);
+    COpenStreetMap StringMap(std::make_shared<CXMLReader>(std::make_shared<CStringDataSource>(Document)));
+    std::filesystem::remove(Filename);
+
+    ASSERT_EQ(MappedMap.NodeCount(),StringMap.NodeCount());
+    ASSERT_EQ(MappedMap.WayCount(),StringMap.WayCount());
+    EXPECT_EQ(MappedMap.NodeCount(),2);
+    EXPECT_EQ(MappedMap.WayCount(),1);
+    for(std::size_t Index = 0; Index < MappedMap.NodeCount(); Index++){
+        auto MappedNode = MappedMap.NodeByIndex(Index);
+        auto StringNode = StringMap.NodeByIndex(Index);
+        EXPECT_EQ(MappedNode->ID(),StringNode->ID());
+        EXPECT_EQ(MappedNode->Location(),StringNode->Location());
+        EXPECT_EQ(MappedNode->AttributeCount(),StringNode->AttributeCount());
+    }
+    auto TempWay = MappedMap.WayByID(100);
+    ASSERT_TRUE(bool(TempWay));
+    EXPECT_EQ(TempWay->NodeCount(),2);
+    EXPECT_EQ(TempWay->GetNodeID(1),2);
+    EXPECT_EQ(TempWay->GetAttribute("oneway"),"yes");
+    EXPECT_EQ(MappedMap.NodeByID(1)->GetAttribute("foot"),"yes");
+}
+
+TEST(OSMTest, MissingFileTest){
+    auto Mapped = std::make_shared<CMemoryMappedDataSource>("/nonexistent/OSMTest.osm");
+    EXPECT_FALSE(Mapped->Valid());
+    EXPECT_TRUE(Mapped->End());
+    COpenStreetMap StreetMap(Mapped);
+
+    EXPECT_EQ(StreetMap.NodeCount(),0);
+    EXPECT_EQ(StreetMap.WayCount(),0);
+}
+
+TEST(OSMTest, NodeStorageTest){
+    std::shared_ptr<CStreetMap::SNode> TaggedNode, PlainNode;
+    {
+        auto InStream = std::make_shared<CStringDataSource>("<?xml version='1.0' encoding='UTF-8'?>"
+                                                            "<osm version=\"0.6\" generator=\"osmconvert 0.8.5\">"
+                                                            "<node id=\"1\" lat=\"1.0\" lon=\"-1.0\"/>"
+                                                            "<node id=\"2\" lat=\"2.0\" lon=\"-2.0\">"
+                                                            "<tag k=\"highway\" v=\"crossing\"/>"
+                                                            "<tag k=\"name\" v=\"First\"/>"
+                                                            "<tag k=\"name\" v=\"Second\"/>"
+                                                            "</node>"
+                                                            "<node id=\"3\" lat=\"3.0\" lon=\"-3.0\">"
+                                                            "<tag k=\"foot\" v=\"no\"/>"
+                                                            "<way id=\"10\"/>"
+                                                            "<node id=\"4\" lat=\"4.0\" lon=\"-4.0\"/>"
+                                                            "</osm>");
+        auto Reader = std::make_shared<CXMLReader>(InStream);
+        COpenStreetMap StreetMap(Reader);
+
+        ASSERT_EQ(StreetMap.NodeCount(),3);
+        EXPECT_EQ(StreetMap.NodeByIndex(2)->ID(),4);
+        EXPECT_EQ(StreetMap.NodeByIndex(2)->AttributeCount(),0);
+        EXPECT_FALSE(bool(StreetMap.NodeByID(3)));
+        TaggedNode = StreetMap.NodeByID(2);
+        PlainNode = StreetMap.NodeByIndex(0);
+        EXPECT_EQ(TaggedNode,StreetMap.NodeByIndex(1));
+    }
+    // nodes stay usable after the map is gone
+    EXPECT_EQ(PlainNode->ID(),1);
+    EXPECT_EQ(PlainNode->Location(),std::make_pair(1.0,-1.0));
+    EXPECT_EQ(PlainNode->AttributeCount(),0);
+    EXPECT_FALSE(PlainNode->HasAttribute("highway"));
+    EXPECT_EQ(TaggedNode->Location(),std::make_pair(2.0,-2.0));
+    ASSERT_EQ(TaggedNode->AttributeCount(),2);
+    EXPECT_EQ(TaggedNode->GetAttributeKey(0),"highway");
+    EXPECT_EQ(TaggedNode->GetAttributeKey(1),"name");
+    EXPECT_EQ(TaggedNode->GetAttributeKey(2),"");
+    EXPECT_EQ(TaggedNode->GetAttribute("name"),"Second");
+    EXPECT_EQ(TaggedNode->GetAttribute("foot"),"");
+}
+
+TEST(OSMTest, ConcurrentNodeTest){
+    std::string Document = "<?xml version='1.0' encoding='UTF-8'?><osm version=\"0.6\">";
+    for(int Index = 0; Index < 1000; Index++){
+        Document += "<node id=\"" + std::to_string(Index + 1) + "\" lat=\"1.0\" lon=\"-1.0\"/>";
+    }
+    Document += "</osm>";
+    COpenStreetMap StreetMap(std::make_shared<CXMLReader>(std::make_shared<CStringDataSource>(Document)));
+    ASSERT_EQ(StreetMap.NodeCount(),1000);
+
+    // threads racing on the first lookup of each node get the same view
+    std::vector< std::vector< std::shared_ptr<CStreetMap::SNode> > > Seen(4);
+    std::vector< std::thread > Threads;
+    for(auto &Nodes : Seen){
+        Threads.emplace_back([&StreetMap, &Nodes](){
+            for(std::size_t Index = 0; Index < StreetMap.NodeCount(); Index++){
+                Nodes.push_back(StreetMap.NodeByIndex(Index));
+            }
+        });
+    }
+    for(auto &Thread : Threads){
+        Thread.join();
+    }
+    for(std::size_t Index = 0; Index < StreetMap.NodeCount(); Index++){
+        EXPECT_EQ(Seen[0][Index]->ID(),Index + 1);
+        for(auto &Nodes : Seen){
+            EXPECT_EQ(Nodes[Index],Seen[0][Index]);
+        }
+        EXPECT_EQ(StreetMap.NodeByID(Index + 1),Seen[0][Index]);
+    }
+
+    // the map does not keep views nobody holds
+    std::weak_ptr<CStreetMap::SNode> Released = Seen[0][0];
+    Seen.clear();
+    EXPECT_TRUE(Released.expired());
+    EXPECT_EQ(StreetMap.NodeByIndex(0).use_count(),1);
+
+    // views are dropped and looked up again on every thread at once
+    Threads.clear();
+    for(int Thread = 0; Thread < 4; Thread++){
+        Threads.emplace_back([&StreetMap](){
+            for(int Round = 0; Round < 2000; Round++){
+                auto Node = StreetMap.NodeByIndex(Round % 4);
+                EXPECT_EQ(Node->ID(),CStreetMap::TNodeID(Round % 4 + 1));
+            }
+        });
+    }
+    for(auto &Thread : Threads){
+        Thread.join();
+    }
+}
+
+TEST(OSMTest, SharedAttributeTest){
+    auto InStream = std::make_shared<CStringDataSource>("<?xml version='1.0' encoding='UTF-8'?>"
+                                                        "<osm version=\"0.6\" generator=\"osmconvert 0.8.5\">"
+                                                        "<node id=\"1\" lat=\"1.0\" lon=\"-1.0\">"
+                                                        "<tag k=\"highway\" v=\"stop\"/>"
+                                                        "</node>"
+                                                        "<way id=\"10\" version=\"2\">"
+                                                        "<nd ref=\"1\"/>"
+                                                        "<tag k=\"highway\" v=\"residential\"/>"
+                                                        "<tag k=\"maxspeed\" v=\"25 mph\"/>"
+                                                        "<tag k=\"maxspeed\" v=\"30 mph\"/>"
+                                                        "</way>"
+                                                        "<way id=\"11\">"
+                                                        "<tag k=\"highway\" v=\"residential\"/>"
+                                                        "<tag k=\"stop\" v=\"highway\"/>"
+                                                        "</way>"
+                                                        "</osm>");
+    auto Reader = std::make_shared<CXMLReader>(InStream);
+    COpenStreetMap StreetMap(Reader);
+
+    auto TempNode = StreetMap.NodeByID(1);
+    ASSERT_TRUE(bool(TempNode));
+    EXPECT_EQ(TempNode->GetAttribute("highway"),"stop");
+    EXPECT_FALSE(TempNode->HasAttribute("residential"));
+    auto FirstWay = StreetMap.WayByID(10);
+    ASSERT_TRUE(bool(FirstWay));
+    ASSERT_EQ(FirstWay->AttributeCount(),3);
+    EXPECT_EQ(FirstWay->GetAttributeKey(0),"version");
+    EXPECT_EQ(FirstWay->GetAttributeKey(1),"highway");
+    EXPECT_EQ(FirstWay->GetAttributeKey(2),"maxspeed");
+    EXPECT_EQ(FirstWay->GetAttribute("version"),"2");
+    EXPECT_EQ(FirstWay->GetAttribute("maxspeed"),"30 mph");
+    EXPECT_FALSE(FirstWay->HasAttribute("stop"));
+    EXPECT_FALSE(FirstWay->HasAttribute("unused"));
+    EXPECT_EQ(FirstWay->GetAttribute("unused"),"");
+    auto SecondWay = StreetMap.WayByID(11);
+    ASSERT_TRUE(bool(SecondWay));
+    EXPECT_EQ(SecondWay->GetAttribute("highway"),"residential");
+    EXPECT_EQ(SecondWay->GetAttribute("stop"),"highway");
+    EXPECT_FALSE(SecondWay->HasAttribute("maxspeed"));
+}
+
+TEST(OSMTest, LoadFilterTest){
+    const std::string Document = "<?xml version='1.0' encoding='UTF-8'?>"
+                                 "<osm version=\"0.6\" generator=\"osmconvert 0.8.5\">"
+                                 "<node id=\"1\" lat=\"1.0\" lon=\"-1.0\">"
+                                 "<tag k=\"highway\" v=\"traffic_signals\"/>"
+                                 "<tag k=\"created_by\" v=\"JOSM\"/>"
+                                 "</node>"
+                                 "<node id=\"2\" lat=\"2.0\" lon=\"-2.0\">"
+                                 "<tag k=\"amenity\" v=\"bench\"/>"
+                                 "</node>"
+                                 "<way id=\"10\" version=\"3\">"
+                                 "<nd ref=\"1\"/>"
+                                 "<nd ref=\"2\"/>"
+                                 "<tag k=\"building\" v=\"yes\"/>"
+                                 "</way>"
+                                 "<way id=\"11\">"
+                                 "<nd ref=\"2\"/>"
+                                 "<nd ref=\"1\"/>"
+                                 "<tag k=\"name\" v=\"Main Street\"/>"
+                                 "<tag k=\"surface\" v=\"asphalt\"/>"
+                                 "<tag k=\"highway\" v=\"residential\"/>"
+                                 "</way>"
+                                 "</osm>";
+    COpenStreetMap FullMap(std::make_shared<CStringDataSource>(Document));
+    COpenStreetMap RoutingMap(std::make_shared<CStringDataSource>(Document),COpenStreetMap::SLoadFilter::Routing());
+
+    EXPECT_EQ(FullMap.WayCount(),2);
+    EXPECT_EQ(FullMap.WayByID(11)->AttributeCount(),3);
+    EXPECT_EQ(FullMap.NodeByID(1)->AttributeCount(),2);
+
+    ASSERT_EQ(RoutingMap.NodeCount(),2);
+    ASSERT_EQ(RoutingMap.WayCount(),1);
+    EXPECT_FALSE(bool(RoutingMap.WayByID(10)));
+    auto TempWay = RoutingMap.WayByIndex(0);
+    EXPECT_EQ(TempWay,RoutingMap.WayByID(11));
+    ASSERT_EQ(TempWay->NodeCount(),2);
+    EXPECT_EQ(TempWay->GetNodeID(0),2);
+    EXPECT_EQ(TempWay->GetNodeID(1),1);
+    EXPECT_EQ(TempWay->AttributeCount(),2);
+    EXPECT_EQ(TempWay->GetAttribute("name"),"Main Street");
+    EXPECT_EQ(TempWay->GetAttribute("highway"),"residential");
+    EXPECT_FALSE(TempWay->HasAttribute("surface"));
+    auto TempNode = RoutingMap.NodeByID(1);
+    ASSERT_EQ(TempNode->AttributeCount(),1);
+    EXPECT_EQ(TempNode->GetAttribute("highway"),"traffic_signals");
+    EXPECT_EQ(RoutingMap.NodeByID(2)->AttributeCount(),0);
+
+    COpenStreetMap::SLoadFilter KeyFilter;
+    KeyFilter.DWayKeys = {"building"};
+    COpenStreetMap BuildingMap(std::make_shared<CStringDataSource>(Document),KeyFilter);
+    ASSERT_EQ(BuildingMap.WayCount(),1);
+    EXPECT_EQ(BuildingMap.WayByIndex(0)->ID(),10);
+    EXPECT_EQ(BuildingMap.WayByIndex(0)->GetAttribute("version"),"3");
+}
+
+TEST(OSMTest, NumberParsingTest){
+    auto InStream = std::make_shared<CStringDataSource>("<?xml version='1.0' encoding='UTF-8'?>"
+                                                        "<osm version=\"0.6\" generator=\"osmconvert 0.8.5\">"
+                                                        "<node id=\"18446744073709551614\" lat=\"-0.0000001\" lon=\"-179.9999999\"/>"
+                                                        "<node id=\"+2\" lat=\"1.5e1\" lon=\"+38\"/>"
+                                                        "<node id=\"3\" lat=\"north\" lon=\"12.5\"/>"
+                                                        "<node id=\"4\" lat=\"12.5west\" lon=\"1\"/>"
+                                                        "<node id=\"5\" lat=\"nan\" lon=\"1\"/>"
+                                                        "<node id=\"-5\" lat=\"1\" lon=\"1\"/>"
+                                                        "<node id=\"+-6\" lat=\"1\" lon=\"1\"/>"
+                                                        "<node id=\"18446744073709551616\" lat=\"1\" lon=\"1\"/>"
+                                                        "<node id=\"\" lat=\"1\" lon=\"1\"><tag k=\"name\" v=\"Bad\"/></node>"
+                                                        "<node id=\"7\" lat=\"2\" lon=\"2\"><tag k=\"name\" v=\"Good\"/></node>"
+                                                        "<way id=\"10\">"
+                                                        "<nd ref=\"18446744073709551614\"/>"
+                                                        "<nd ref=\"2\"/>"
+                                                        "</way>"
+                                                        "<way id=\"11\">"
+                                                        "<nd ref=\"2\"/>"
+                                                        "<nd ref=\"bad\"/>"
+                                                        "</way>"
+                                                        "<way id=\"x12\">"
+                                                        "<nd ref=\"2\"/>"
+                                                        "</way>"
+                                                        "</osm>");
+    auto Reader = std::make_shared<CXMLReader>(InStream);
+    COpenStreetMap StreetMap(Reader);
+
+    // nodes whose ID or location does not parse are dropped, not stored as 0
+    ASSERT_EQ(StreetMap.NodeCount(),3);
+    EXPECT_EQ(StreetMap.NodeByIndex(0)->ID(),18446744073709551614ULL);
+    EXPECT_EQ(StreetMap.NodeByIndex(0)->Location(),std::make_pair(-0.0000001,-179.9999999));
+    EXPECT_EQ(StreetMap.NodeByID(2)->Location(),std::make_pair(15.0,38.0));
+    EXPECT_FALSE(bool(StreetMap.NodeByID(0)));
+    EXPECT_FALSE(bool(StreetMap.NodeByID(3)));
+    EXPECT_FALSE(bool(StreetMap.NodeByID(4)));
+    EXPECT_FALSE(bool(StreetMap.NodeByID(5)));
+    ASSERT_TRUE(bool(StreetMap.NodeByID(7)));
+    EXPECT_EQ(StreetMap.NodeByID(7)->GetAttribute("name"),"Good");
+    EXPECT_EQ(StreetMap.NodeByIndex(2)->ID(),7);
+
+    // so are ways whose ID or node references do not parse
+    ASSERT_EQ(StreetMap.WayCount(),1);
+    auto TempWay = StreetMap.WayByID(10);
+    ASSERT_TRUE(bool(TempWay));
+    ASSERT_EQ(TempWay->NodeCount(),2);
+    EXPECT_EQ(TempWay->GetNodeID(0),18446744073709551614ULL);
+    EXPECT_EQ(TempWay->GetNodeID(1),2);
+    EXPECT_FALSE(bool(StreetMap.WayByID(11)));
+    EXPECT_FALSE(bool(StreetMap.WayByID(0)));
+}
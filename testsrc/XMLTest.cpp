@@ -32,3 +32,47 @@ TEST(XMLTest, BasicReadWrite) {
     // After all entities are processed, check if the output matches the original input
     EXPECT_EQ(sink->String(), "<tag>data</tag>");
 }
+
+// records the events Parse hands over so they can be compared as text
+class CRecordingHandler : public CXMLHandler{
+    public:
+        std::string DEvents;
+
+        void StartElement(const char *name, const char **attributes) override{
+            DEvents += std::string("<") + name;
+            for(int Index = 0; attributes[Index]; Index += 2){
+                DEvents += std::string(" ") + attributes[Index] + "=" + attributes[Index + 1];
+            }
+            DEvents += ">";
+        };
+        void EndElement(const char *name) override{
+            DEvents += std::string("</") + name + ">";
+        };
+        void CharData(const char *data, int length) override{
+            DEvents.append(data, length);
+        };
+};
+
+TEST(XMLTest, ParseAfterReadEntity) {
+    auto src = std::make_shared<CStringDataSource>("<osm><node id=\"1\">text</node><way id=\"2\"/></osm>");
+    CXMLReader reader(src);
+    SXMLEntity entity;
+
+    ASSERT_TRUE(reader.ReadEntity(entity));
+    EXPECT_EQ(entity.DNameData, "osm");
+
+    // the entities already parsed are replayed before the rest of the document
+    CRecordingHandler handler;
+    EXPECT_TRUE(reader.Parse(handler));
+    EXPECT_EQ(handler.DEvents, "<node id=1>text</node><way id=2></way></osm>");
+    EXPECT_TRUE(reader.End());
+    EXPECT_FALSE(reader.ReadEntity(entity));
+}
+
+TEST(XMLTest, ParseMalformed) {
+    auto src = std::make_shared<CStringDataSource>("<osm><node></osm>");
+    CXMLReader reader(src);
+    CRecordingHandler handler;
+
+    EXPECT_FALSE(reader.Parse(handler));
+}